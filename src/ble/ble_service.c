@@ -6,6 +6,8 @@
 #include "gatt.h"
 #include "ble_service.h"
 #include "config/config.h"
+#include "utils/event_loop.h"
+#include "utils/boot_timeline.h"
 
 #define MIN_CONN_INTERVAL 8     //10ms (8 * 1.25ms)
 #define MAX_CONN_INTERVAL 16    //20ms
@@ -21,6 +23,9 @@ static bool led_state = false;
 static bool timer_setup = false;
 static bool connection_params_updated = false;
 static bool new_data_available = false;
+static bool stack_initialized = false;     // l2cap, SM and the ATT server survive a stop
+static volatile bool advertising = false;
+static volatile uint32_t advertising_since_ms;
 static uint32_t last_send_time = 0;
 static const uint32_t MIN_SEND_INTERVAL_MS = BME680_SAMPLE_PERIOD_MS - 100;
 
@@ -54,6 +59,18 @@ static void initialize_sensor_data(void) {
     memset(&current_data, 0, sizeof(sensor_data));
 }
 
+bool ble_is_connected(void) {
+    return con_handle != HCI_CON_HANDLE_INVALID;
+}
+
+bool ble_is_advertising(void) {
+    return advertising;
+}
+
+uint32_t ble_advertising_since_ms(void) {
+    return advertising_since_ms;
+}
+
 void update_sensor_data(sensor_data* data) {
     if (data != NULL) {
         memcpy(&current_data, data, sizeof(sensor_data));
@@ -158,7 +175,11 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
             gap_advertisements_set_params(adv_int_min, adv_int_max, adv_type, 0, null_addr, 0x07, 0x00);
             gap_advertisements_set_data(adv_data_len, adv_data);
             gap_advertisements_enable(1);
+            advertising = true;
+            advertising_since_ms = to_ms_since_boot(get_absolute_time());
+            boot_mark(BOOT_ADVERTISING);
             printf("Advertising started\n");
+            event_post(EVENT_BLE);
             start_led_blink();
             break;
 
@@ -169,6 +190,9 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
             connection_params_updated = false;
             printf("Disconnected\n");
             gap_advertisements_enable(1);
+            advertising = true;
+            advertising_since_ms = to_ms_since_boot(get_absolute_time());
+            event_post(EVENT_BLE);
             start_led_blink();
             break;
 
@@ -176,7 +200,9 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
             switch(hci_event_le_meta_get_subevent_code(packet)) {
                 case HCI_SUBEVENT_LE_CONNECTION_COMPLETE:
                     con_handle = hci_subevent_le_connection_complete_get_connection_handle(packet);
+                    advertising = false;
                     printf("Connected\n");
+                    event_post(EVENT_BLE);
                     stop_led_blink();
 
                     if (!connection_params_updated) {
@@ -248,16 +274,22 @@ int att_write_callback(hci_con_handle_t connection_handle, uint16_t att_handle,
 int start_ble_service(void) {
     printf("Starting BLE service...\n");
 
-    l2cap_init();
-    sm_init();
+    // after a stop only the controller is powered back up; the GATT database,
+    // advertising data and the last sensor payload are kept, so a client
+    // reconnecting after a deep sleep reads the last values right away
+    if (!stack_initialized) {
+        l2cap_init();
+        sm_init();
 
-    hci_event_callback_registration.callback = &packet_handler;
-    hci_add_event_handler(&hci_event_callback_registration);
+        att_server_init(profile_data, att_read_callback, att_write_callback);
+        att_server_register_packet_handler(packet_handler);
 
-    att_server_init(profile_data, att_read_callback, att_write_callback);
-    att_server_register_packet_handler(packet_handler);
+        initialize_sensor_data();
+        stack_initialized = true;
+    }
 
-    initialize_sensor_data();
+    hci_event_callback_registration.callback = &packet_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
 
     if (hci_power_control(HCI_POWER_ON) != 0) {
         printf("HCI Power on failed\n");
@@ -279,6 +311,8 @@ void stop_ble_service(void) {
 
     // 2. 停止廣播
     gap_advertisements_enable(0);
+    advertising = false;
+    stop_led_blink();
     sleep_ms(50);  // 給予時間停止廣播
 
     // 3. 斷開現有連接
@@ -1,6 +1,12 @@
 #ifndef BLE_SERVICE_H
 #define BLE_SERVICE_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BLE_QUALITY_AIR_WARMING 0x01    // temperature to VOC values are from a warming sensor
+#define BLE_QUALITY_PM_WARMING  0x02    // pm25 is from a warming sensor
+
 typedef struct __attribute__((packed)) {
     float temperature;
     float humidity;
@@ -8,12 +14,17 @@ typedef struct __attribute__((packed)) {
     float gas_resistance;
     float voc_ppm;
     float pm25;
+    uint8_t quality;    // BLE_QUALITY_* bits, appended so older clients still parse the floats
 } sensor_data;
 
 int start_ble_service(void);
 void update_sensor_data(sensor_data* data);
 void send_sensor_data(void);
 void stop_ble_service(void);
+bool ble_is_connected(void);
+bool ble_is_advertising(void);
+// when advertising last started, ms since boot
+uint32_t ble_advertising_since_ms(void);
 
 
 #endif // BLE_SERVICE_H
\ No newline at end of file
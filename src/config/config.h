@@ -4,16 +4,64 @@
 #include "pin_config.h"
 
 //General timing configs
-#define MAIN_LOOP_DELAY_MS        1000
 #define SERIAL_INIT_DELAY_MS      6000
+#define SLEEP_PRE_WAKE_MS         20000   //sleep entry to PM sensor power-on
+#define SLEEP_PM_WARMUP_MS        15000   //PM power-on to the full wake check
+#define POWER_DEEP_SLEEP_ENABLED  1       //BLE off and PLLs stopped while asleep without a client, USB serial drops out
 
 //I2C configs
 #define I2C0_FREQ         400000  //400 khz
+#define I2C1_FREQ         100000  //PMSA003 is limited to 100 khz
+#define LIS3_I2C_TIMEOUT_US         8000    //per transfer, a full 192-byte FIFO drain takes ~4.5 ms at 400 khz
+#define BME680_I2C_TIMEOUT_US       5000    //per transfer, covers the 42-byte calibration block
+#define PMSA003_I2C_TIMEOUT_US      10000   //per transfer, a 32-byte frame takes ~3 ms at 100 khz
 
 //BME680 configs
 #define BME680_SAMPLE_PERIOD_MS     3000
 #define BME680_HEATER_DURATION_MS   150
 #define BME680_WARMUP_TIME_MS       250
 #define BME680_VOC_MAX_PPM          10.0f
+#define BME680_FAST_FIELD_READ      1       //single-burst result read using cached heater registers
+#define BME680_POLL_RETRY_US        2000    //re-check interval when the conversion is still running
+#define BME680_POLL_MAX_RETRIES     10
+#define BME680_TRACE_OUTPUT         0       //log every gas reading for replay through the host IAQ harness
+#define BME680_BOOT_READY_MAX_MS    180000  //upper bound on gas warm-up after power-on, usually settles sooner
+#define BME680_WAKE_READY_MAX_MS    60000   //upper bound after a sleep, the heater only cooled for minutes
+#define BME680_SCAN_EVERY           10      //every n-th sample period runs a heater scan instead, 0 disables
+#define BME680_SCAN_STEPS           10      //set-points used, at most BME680_SCAN_MAX_STEPS
+#define BME680_SCAN_TEMPS_C         {200, 240, 280, 320, 360, 400, 360, 320, 280, 240}
+#define BME680_SCAN_DUR_MS          {150, 100, 100, 100, 100, 100, 100, 100, 100, 100}  //first step heats from ambient
+#define BME680_CALIB_FLASH_OFFSET   (PICO_FLASH_SIZE_BYTES - PICO_FLASH_BANK_TOTAL_SIZE - FLASH_SECTOR_SIZE)  //sector below the BTstack key store
+
+//PMSA003 sampling window configs
+#define PM_WINDOW_SPINUP_MS         6000    //fan spin-up after the SET pin goes high
+#define PM_WINDOW_STABILISE_MS      24000   //datasheet asks for ~30 s before data is stable
+#define PM_WINDOW_FRAMES            5       //frames averaged per window
+#define PM_WINDOW_PERIOD_MS         60000   //window start to window start
+#define PM_CHECK_FAN_ON_MS          12000   //fan-on time after which check burst frames vote, inside the SLEEP_PM_WARMUP_MS pre-wake
+
+//Core1 acquisition configs
+#define ACQ_SAMPLE_PERIOD_MS        7000    //BME680 sample and BLE update period
+#define ACQ_POLL_INTERVAL_MS        100     //core1 loop period while sampling, each poll also wakes core0
+#define ACQ_QUEUE_DEPTH             16      //samples buffered for core0, power of two
+#define WORK_QUEUE_DEPTH            16      //deferred interrupt work items, power of two
+#define ACQ_CHECK_PERIOD_MS         300     //check burst sample spacing, a forced measurement takes ~200 ms
+#define ACQ_CHECK_MIN_WAIT_US       1000    //keeps core1 from spinning while a result is being read
+#define ACQ_IDLE_ACK_TIMEOUT_MS     100     //core1 finishing its transfers before a sleep, above every device timeout
+
+//Abnormal air detection
+#define AQI_ABNORMAL_THRESHOLD      56      //AQI of 12 ug/m3 PM2.5 on the 2024 EPA table, 13 and up is abnormal (PM10 from 67)
+#define ANOMALY_VOC_PPB             500     //VOC estimate counted as abnormal once the IAQ baseline is set
+#define ANOMALY_WINDOW              5       //n: votes in the sliding window
+#define ANOMALY_VOTES               3       //k: abnormal votes that confirm an anomaly
+
+//LIS3 configs
+#define LIS3_INACTIVITY_THRESHOLD_MG    64      //below this the device counts as stationary
+#define LIS3_INACTIVITY_DURATION_MS     20000   //stationary time before INT2 asserts
+#define LIS3_CLASSIFY_HOLD_MS           5000    //longest time at the high rate after motion, ends early once the device is still
+#define LIS3_FIFO_WATERMARK             16      //samples, 160 ms at the classify rate and drained within one core1 poll
+#define LIS3_MOTION_THRESHOLD_MG        100     //high-pass filtered magnitude counted as moving
+#define LIS3_MOTION_STILL_SAMPLES       50      //still samples that end a bout, 0.5 s at the classify rate
+#define LIS3_MOTION_POLL_MS             1000    //polled motion sample below the classify rate
 
 #endif //CONFIG_H
@@ -13,5 +13,6 @@
 #define PM25_SET_PIN               12  // GPIO pin connected to the SET pin of PM2.5 sensor
 
 #define ACCEL_INT_PIN              7      // GPIO pin for accelerometer interrupt
+#define ACCEL_INT2_PIN             6      // GPIO pin for accelerometer INT2 (activity/inactivity)
 
 #endif //PIN_CONFIG_H
\ No newline at end of file
@@ -8,10 +8,19 @@
 #include "tusb.h"
 #include "sensors/bme680.h"
 #include "pmsa003.h"
+#include "pm_scheduler.h"
+#include "acquisition.h"
+#include "anomaly.h"
+#include "utils/event_loop.h"
+#include "utils/boot_timeline.h"
+#include "utils/i2c_dma.h"
+#include "utils/work_queue.h"
+#include "utils/gpio_dispatch.h"
+#include "utils/sleep_timer.h"
+#include "power/power_manager.h"
 #include "lis3.h"
 #include "ble_service.h"
 #include "hardware/i2c.h"
-#include "hardware/rtc.h"
 #include "hardware/gpio.h"
 #include "config/pin_config.h"
 #include "config/config.h"
@@ -21,120 +30,167 @@
 #include "hardware/rosc.h"
 #include "hardware/clocks.h"
 
-// Constants for power management
-#define SLEEP_TIMEOUT 10      // 10 minutes in seconds
-#define SLEEP_CHECK_INTERVAL 10 // 30 seconds interval for sensor check in sleep mode
-#define SENSOR_WARM_UP_DELAY_MS 180000
-
 // Global variables for power management
 static volatile bool awake = true;
-static bool temp_check = false;
-static bool movement_wake_up = false;
 
 // Function declarations
-static void sleep_callback(void);
 static void accel_interrupt_handler(uint gpio, uint32_t events);
-static void handle_time_overflow(datetime_t *time);
+static void accel_work(uint32_t events, uint32_t latency_us);
+static void int1_interrupt_handler(uint gpio, uint32_t events);
+static void int1_work(uint32_t events, uint32_t latency_us);
+static void wake_timer_work(uint32_t arg, uint32_t latency_us);
 static void enter_sleep_mode(void);
-static void leave_sleep_mode(void);
-static bool is_abnormal(void);
+static void leave_sleep_mode(bool ble);
 static bool initialize_hardware(void);
 
-int LIS3_operation_mode = 1;
+int LIS3_operation_mode = 2;
 air_quality_t data; // bme sensor data
 uint16_t pm1_0, pm2_5, pm10;
 
-sensor_data ble_data;
+sensor_data ble_data = { .quality = BLE_QUALITY_AIR_WARMING | BLE_QUALITY_PM_WARMING };
 pmsa003_data_t pmsa_data;
-uint32_t reading_count = 0;
-absolute_time_t next_update;
+static const pm_window_config_t pm_window_config = {
+    .spinup_ms = PM_WINDOW_SPINUP_MS,
+    .stabilise_ms = PM_WINDOW_STABILISE_MS,
+    .frames = PM_WINDOW_FRAMES,
+    .period_ms = PM_WINDOW_PERIOD_MS,
+    .check_on_ms = PM_CHECK_FAN_ON_MS
+};
 
 typedef enum {
     PRE_WAKE, // Pre-wake for PM2.5 sensor
     FULL_WAKE // Wake from sleep mode
 } WakeState;
 
-static WakeState wake_state;
+// both deadlines are queued when entering sleep, the full wake follows the pre-wake
+static sleep_timer_t pre_wake_timer;
+static sleep_timer_t full_wake_timer;
+
+// k-of-n vote over incoming samples, decides whether a timer wake stays awake
+static anomaly_detector_t anomaly;
+static bool checking = false;
+static uint32_t check_start_ms;
+static uint32_t check_cycles;
+static uint32_t check_awake_ms;     // summed over check_cycles
+
+// interrupt handlers only defer, the work ids are registered in main
+static int accel_work_id;
+static int int1_work_id;
+static int wake_work_id;
+static bool ble_client = false;     // last connection state reported
+
+static void cancel_wake_timers(void) {
+    sleep_timer_cancel(&pre_wake_timer);
+    sleep_timer_cancel(&full_wake_timer);
+}
 
-// Accelerometer interrupt handler
-static void accel_interrupt_handler(uint gpio, uint32_t events) {
-    //clear interrupt immediately
-    gpio_acknowledge_irq(ACCEL_INT_PIN, GPIO_IRQ_EDGE_RISE);
+static void wake_on_motion(const char *source, uint32_t latency_us) {
+    cancel_wake_timers();
 
-    rtc_disable_alarm(); // disable any alarms
+    pm_scheduler_power(true); // turn PM2.5 sensor on
+    event_post(EVENT_MOTION);
+    printf("Movement detected on %s! (%lu us after the interrupt)\n", source, latency_us);
+}
 
-    if (gpio == ACCEL_INT_PIN) {
-        gpio_put(PM25_SET_PIN, 1); // immediately turn PM2.5 sensor on
-        movement_wake_up = true;
-        printf("Movement detected!\n");
+// Accelerometer interrupt handler, runs from the GPIO dispatcher
+static void accel_interrupt_handler(uint gpio, uint32_t events) {
+    //clear interrupt immediately
+    gpio_acknowledge_irq(gpio, events);
+    work_defer(accel_work_id, events);
+}
 
-        //disable GPIO interrupt
-        gpio_set_irq_enabled(ACCEL_INT_PIN, GPIO_IRQ_EDGE_RISE, false);
-        disable_movement_detection(); // disable interrupt
+// INT2 follows the LIS3DH inactivity state: rising edge = stationary, falling edge = activity
+static void accel_work(uint32_t events, uint32_t latency_us) {
+    if (awake) {
+        if (events & GPIO_IRQ_EDGE_RISE) {
+            event_post(EVENT_STATIONARY);
+        }
+    } else if (events & GPIO_IRQ_EDGE_FALL) {
+        wake_on_motion("INT2", latency_us);
     }
 }
 
-// RTC wake-up callback
-static void sleep_callback(void) {
-    if (wake_state == PRE_WAKE) {
-        printf("Pre-wake: Turning on PM sensor...\n");
-        gpio_put(PM25_SET_PIN, 1); // Turn on PM2.5 sensor
-
-        // Get current time and calculate full wake time (15 seconds later)
-        datetime_t current_time;
-        rtc_get_datetime(&current_time);
-        datetime_t t_full_wake = current_time;
-        t_full_wake.sec += 15; // Full wake after giving pm 15 seconds to warm up
-        handle_time_overflow(&t_full_wake);
+// INT1 carries the LIS3DH wake-up threshold interrupt, only enabled in the deep tier
+static void int1_interrupt_handler(uint gpio, uint32_t events) {
+    gpio_acknowledge_irq(gpio, events);
+    work_defer(int1_work_id, events);
+}
 
-        /*printf("Full wake alarm set for %04d-%02d-%02d %02d:%02d:%02d\n",
-               t_full_wake.year, t_full_wake.month, t_full_wake.day,
-               t_full_wake.hour, t_full_wake.min, t_full_wake.sec);*/
+static void int1_work(uint32_t events, uint32_t latency_us) {
+    if (!awake) {
+        wake_on_motion("INT1", latency_us);
+    }
+}
 
-        // Set RTC alarm for full wake
-        wake_state = FULL_WAKE;
-        rtc_set_alarm(&t_full_wake, &sleep_callback);
+// Re-arms sleep entry when the device is awake but INT2 is already high,
+// since no new rising edge will arrive in that case
+static int64_t stationary_recheck_callback(alarm_id_t id, void *user_data) {
+    if (awake && gpio_get(ACCEL_INT2_PIN)) {
+        event_post(EVENT_STATIONARY);
+    }
+    return 0;
+}
 
-    } else if (wake_state == FULL_WAKE) {
+// sleep timer expiry, the PM sensor gets its warm-up before the full wake
+static void wake_timer_work(uint32_t arg, uint32_t latency_us) {
+    if ((WakeState) arg == PRE_WAKE) {
+        printf("Pre-wake: Turning on PM sensor...\n");
+        pm_scheduler_power(true); // Turn on PM2.5 sensor
+    } else if ((WakeState) arg == FULL_WAKE) {
         printf("Full wake: Leaving sleep mode to do temp check...\n");
-        temp_check = true; // Main logic gets triggered
+        event_post(EVENT_WAKE_TIMER); // Main logic gets triggered
     }
 }
 
 // Initialize hardware
+// The radio and BLE come up first so the device advertises within seconds of
+// power-on; sensors warm up in the background and samples carry warming
+// flags until they are ready.
 static bool initialize_hardware(void) {
     stdio_init_all();
-    sleep_ms(SERIAL_INIT_DELAY_MS); //delay for USB serial monitoring
 
-    // initialize accelerometer interrupt pin
+    // initialize accelerometer interrupt pins
     gpio_init(ACCEL_INT_PIN);
     gpio_set_dir(ACCEL_INT_PIN, GPIO_IN);
     gpio_pull_down(ACCEL_INT_PIN);
     //gpio_set_irq_enabled_with_callback(ACCEL_INT_PIN, GPIO_IRQ_EDGE_RISE, true, &accel_interrupt_handler);
 
+    gpio_init(ACCEL_INT2_PIN);
+    gpio_set_dir(ACCEL_INT2_PIN, GPIO_IN);
+    gpio_pull_down(ACCEL_INT2_PIN);
+
     // initialize the PM2.5 set pin
     gpio_init(PM25_SET_PIN);
     gpio_set_dir(PM25_SET_PIN, GPIO_OUT);
-    gpio_put(PM25_SET_PIN, 1); // default sensor working state
+    gpio_put(PM25_SET_PIN, 1); // default sensor working state, the fan starts warming now
 
     // Initialize CYW43 for LED control
     printf("Starting CYW43 initialization\n");
     if (cyw43_arch_init()) {
         printf("CYW43 init failed!\n");
-        return -1;
+        return false;
     }
+    boot_mark(BOOT_RADIO_UP);
     printf("CYW43 initialized\n");
 
+    // initialize BLE, advertising starts from the btstack background handler
+    printf("Starting BLE service initialization...\n");
+    if (start_ble_service() != 0) {
+        printf("Failed to start BLE service\n");
+        return false;
+    }
+    printf("BLE service started successfully\n");
+
+    sleep_ms(SERIAL_INIT_DELAY_MS); //delay for USB serial monitoring, BLE is already advertising
+
     // initialize i2c0 port
-    i2c_init(i2c0, I2C0_FREQ);
-    gpio_set_function(I2C0_SDA_PIN, GPIO_FUNC_I2C);
-    gpio_set_function(I2C0_SCL_PIN, GPIO_FUNC_I2C);
-    gpio_pull_up(I2C0_SDA_PIN);
-    gpio_pull_up(I2C0_SCL_PIN);
+    i2c_dma_init(i2c0, I2C0_FREQ, I2C0_SDA_PIN, I2C0_SCL_PIN);
 
     // initialize sensors
     // initialize LIS3
     LIS3_init(i2c0, LIS3_operation_mode);
+    LIS3_enable_activity_detection(LIS3_INACTIVITY_THRESHOLD_MG, LIS3_INACTIVITY_DURATION_MS);
+    LIS3_set_rate_state(LIS3_RATE_IDLE);
     sleep_ms(100);
     printf("LIS3DH initialized\n");
 
@@ -146,112 +202,160 @@ static bool initialize_hardware(void) {
     sleep_ms(100);
     printf("BME680 initialized\n");
 
+    bme680_boot_stats_t bme_boot;
+    bme680_get_boot_stats(&bme_boot);
+    printf("BME680 init: %lu us, %lu I2C transactions, calibration from %s (store %lu us)\n",
+           bme_boot.init_us, bme_boot.init_transactions,
+           bme_boot.calib_from_flash ? "flash" : "sensor", bme_boot.save_us);
+
     // initialize pmsa003
     pmsa003_init(i2c1);
+    pm_scheduler_init(&pm_window_config);
     printf("PMSA003 initialized\n");
 
-    // Warm-up delay
-    printf("Sensors are warming up. Please wait...\n");
-    sleep_ms(SENSOR_WARM_UP_DELAY_MS);
-
-    printf("Sensors warmed up and ready for operation.\n");
+    boot_mark(BOOT_SENSORS_UP);
+    printf("Sensors are warming up, samples are flagged until they are ready.\n");
+    return true;
+}
 
-    // initialize BLE
-    printf("Starting BLE service initialization...\n");
-    if (start_ble_service() != 0) {
-        printf("Failed to start BLE service\n");
-        return false;
+// deferred interrupt work: queueing latency per handler, then time spent in the ISRs
+static void print_work_stats(void) {
+    work_stats_t ws;
+    for (int id = 0; work_get_stats(id, &ws); id++) {
+        if (ws.runs > 0) {
+            printf("%s work: %lu runs, %lu dropped, latency avg %lu us, max %lu us\n",
+                   ws.name, ws.runs, ws.dropped, ws.total_latency_us / ws.runs, ws.max_latency_us);
+        }
     }
-    printf("BLE service started successfully\n");
+    isr_timing_t it;
+    if (gpio_dispatch_get_timing(ACCEL_INT2_PIN, &it) && it.count > 0) {
+        printf("INT2 ISR: %lu calls, avg %lu us, max %lu us\n", it.count, it.total_us / it.count, it.max_us);
+    }
+    sleep_timer_get_isr_timing(&it);
+    if (it.count > 0) {
+        printf("Timer ISR: %lu calls, avg %lu us, max %lu us\n", it.count, it.total_us / it.count, it.max_us);
+    }
+}
 
-    rtc_init();
-    // Set a valid initial datetime to ensure RTC is running
-    datetime_t initial_time = {
-        .year  = 2024,
-        .month = 1,
-        .day   = 1,
-        .dotw  = 1, // Monday
-        .hour  = 0,
-        .min   = 0,
-        .sec   = 0
-    };
-
-    if (!rtc_set_datetime(&initial_time)) {
-        printf("Failed to set initial RTC time!\n");
-        return false;
+// time in each power tier since boot, and how quickly BLE comes back from the deep tier
+static void print_power_stats(void) {
+    power_stats_t ps;
+    power_get_stats(&ps);
+    printf("Power tiers:");
+    for (int t = 0; t < POWER_TIER_COUNT; t++) {
+        printf(" %s %lu ms (%lu),", power_tier_name(t), ps.time_ms[t], ps.entries[t]);
     }
+    printf(" BLE restarts %lu, wake to advertising %lu ms (max %lu ms)\n",
+           ps.ble_restarts, ps.last_advertise_ms, ps.max_advertise_ms);
+}
 
-    // Enable RTC's interrupt
-    rtc_enable_alarm();
+// prints the register cache counters accumulated since the previous call
+static void print_reg_cache_stats(const char *name, const reg_cache_stats_t *now, reg_cache_stats_t *last) {
+    printf("%s reg cache: %lu hits, %lu misses, %lu writes, %lu skipped, %lu transactions\n",
+           name, now->read_hits - last->read_hits, now->read_misses - last->read_misses,
+           now->writes - last->writes, now->write_skips - last->write_skips,
+           now->transactions - last->transactions);
+    *last = *now;
+}
 
-    printf("RTC initialized successfully\n");
-    return true;
+// CPU cost per transfer is setup plus completion interrupt, the rest of the bus time is free
+static void print_i2c_dma_stats(const char *name, i2c_inst_t *i2c) {
+    i2c_dma_stats_t stats;
+    i2c_dma_get_stats(i2c, &stats);
+    if (stats.transfers == 0) {
+        return;
+    }
+    printf("%s DMA: %lu transfers, %lu errors, %lu timeouts, %lu bus clears, per transfer %lu us CPU, %lu us waited\n",
+           name, stats.transfers, stats.errors, stats.timeouts, stats.recoveries,
+           stats.cpu_us / stats.transfers, stats.wait_us / stats.transfers);
 }
 
-static void handle_time_overflow(datetime_t *time) {
-    if (time->sec >= 60) {
-        time->sec -= 60;
-        time->min += 1;
-        if (time->min >= 60) {
-            time->min -= 60;
-            time->hour += 1;
-            if (time->hour >= 24) {
-                time->hour -= 24;
-                time->day += 1;
-                // Note: Handle month and year overflow if necessary
-            }
+// both buses against core1's samples; a blocking transfer spins for at
+// least 9 bit times per payload byte, the DMA engine only for setup and the interrupt
+static void print_i2c_cpu_per_sample(uint32_t samples) {
+    if (samples == 0) {
+        return;
+    }
+    i2c_dma_stats_t s0, s1;
+    i2c_dma_get_stats(i2c0, &s0);
+    i2c_dma_get_stats(i2c1, &s1);
+    uint64_t spin_us = (uint64_t) s0.bytes * 9 * 1000000 / I2C0_FREQ + (uint64_t) s1.bytes * 9 * 1000000 / I2C1_FREQ;
+    printf("I2C CPU per sample: %lu us with DMA, %lu us spun by blocking transfers\n",
+           (s0.cpu_us + s1.cpu_us) / samples, (uint32_t) (spin_us / samples));
+}
+
+// latency from queueing to completion, bucket b is below 64 << b us
+static void print_i2c_device_stats(void) {
+    for (const i2c_dma_device_t *dev = i2c_dma_next_device(NULL); dev; dev = i2c_dma_next_device(dev)) {
+        const i2c_dma_device_stats_t *st = &dev->stats;
+        printf("%s I2C: %lu transfers, %lu errors, %lu timeouts, max %lu us, latency",
+               dev->name, st->transfers, st->errors, st->timeouts, st->max_latency_us);
+        for (int b = 0; b < I2C_DMA_LAT_BUCKETS; b++) {
+            printf(" %lu", st->latency_hist[b]);
         }
+        printf("\n");
     }
 }
 
 static void enter_sleep_mode(void) {
+    static reg_cache_stats_t lis3_cache_last, bme_cache_last;
     sleep_ms(1000);
 
+    // configuration traffic for the wake cycle that is ending
+    reg_cache_stats_t cache_stats;
+    LIS3_get_reg_cache_stats(&cache_stats);
+    print_reg_cache_stats("LIS3DH", &cache_stats, &lis3_cache_last);
+    bme680_get_reg_cache_stats(&cache_stats);
+    print_reg_cache_stats("BME680", &cache_stats, &bme_cache_last);
+
     printf("Turning off PM sensor\n");
-    gpio_put(PM25_SET_PIN, 0); // send PM2.5 sensor to sleep
-
-    // Get current time
-    datetime_t current_time;
-    rtc_get_datetime(&current_time);
-    /*printf("Current time: %04d-%02d-%02d %02d:%02d:%02d\n",
-           current_time.year, current_time.month, current_time.day,
-           current_time.hour, current_time.min, current_time.sec);*/
-
-    // Create pre-alarm time to wake up PM
-    datetime_t t_pre_alarm = current_time;
-    t_pre_alarm.sec += 20; // 10 seconds prior to wakeup timer to give pm sensor time to warm up
-    handle_time_overflow(&t_pre_alarm);
-
-    /*printf("Pre-wake alarm set for %04d-%02d-%02d %02d:%02d:%02d\n",
-               t_pre_alarm.year, t_pre_alarm.month, t_pre_alarm.day,
-               t_pre_alarm.hour, t_pre_alarm.min, t_pre_alarm.sec);*/
-
-    // Reduce clock frequencies to save power while keeping BLE
-    clock_configure(clk_peri, //clk_sys(cpu clock), clk_ref(clk_ref)
-                   0,
-                   CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS,
-                   12000000,  // Reduce to 12MHz
-                   12000000);
+    // PM2.5 sensor and accelerometer to sleep on core1, clocks may only change once it is idle
+    bool core1_idle = acquisition_sleep();
+    if (!core1_idle) {
+        printf("Core1 did not go idle, keeping the clocks up\n");
+    }
 
-    uart_default_tx_wait_blocking(); // Ensure message is sent
+    // PM pre-wake, then the full wake once the fan has had time to warm up
+    sleep_timer_start(&pre_wake_timer, SLEEP_PRE_WAKE_MS, wake_work_id, PRE_WAKE);
+    sleep_timer_start(&full_wake_timer, SLEEP_PRE_WAKE_MS + SLEEP_PM_WARMUP_MS, wake_work_id, FULL_WAKE);
 
-    enable_movement_detection();
-    gpio_acknowledge_irq(ACCEL_INT_PIN, GPIO_IRQ_EDGE_RISE);
-    gpio_set_irq_enabled_with_callback(ACCEL_INT_PIN, GPIO_IRQ_EDGE_RISE, true, &accel_interrupt_handler);
+    // the main loop waits in __wfe until a wake timer or the accelerometer posts an event
+    uint64_t next_wake_ms;
+    if (sleep_timer_next_deadline(&next_wake_ms)) {
+        printf("Next wake-up in %lu ms\n", (uint32_t) (next_wake_ms - sleep_timer_now_ms()));
+    }
 
-    // Set RTC alarm for pre wake
-    wake_state = PRE_WAKE;
-    rtc_set_alarm(&t_pre_alarm, &sleep_callback);
-    //printf("RTC alarm set\n");
+    // nobody to serve over BLE, the radio goes off with the PLLs
+    if (POWER_DEEP_SLEEP_ENABLED && core1_idle && !ble_is_connected()) {
+        printf("Entering deep sleep mode (BLE off)...\n");
+        uart_default_tx_wait_blocking(); // Ensure message is sent
+        gpio_dispatch_add(ACCEL_INT_PIN, GPIO_IRQ_EDGE_RISE, &int1_interrupt_handler);
+        power_enter_deep();
+    } else {
+        // Reduce clock frequencies to save power while keeping BLE
+        if (core1_idle) {
+            clock_configure(clk_peri, //clk_sys(cpu clock), clk_ref(clk_ref)
+                           0,
+                           CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS,
+                           12000000,  // Reduce to 12MHz
+                           12000000);
+        }
 
-    // Enter light sleep mode using WFI
-    printf("Entering light sleep mode (BLE stays active)...\n");
+        uart_default_tx_wait_blocking(); // Ensure message is sent
+        printf("Entering light sleep mode (BLE stays active)...\n");
+        power_enter_light();
+    }
     awake = false;
-    __wfi();  // Wait for interrupt while keeping BLE active
 }
 
-static void leave_sleep_mode(void) {
-    rtc_disable_alarm(); // disable any alarms
+// ble restarts the radio if the deep tier stopped it; only these wakes are
+// signalled on the LED, a timer wake runs its check and sleeps again
+static void leave_sleep_mode(bool ble) {
+    cancel_wake_timers();
+    if (power_get_tier() == POWER_TIER_DEEP) {
+        gpio_dispatch_remove(ACCEL_INT_PIN);
+    }
+    power_wake(ble);
 
     // Restore clock frequencies to full speed
     clock_configure(clk_peri,
@@ -260,75 +364,121 @@ static void leave_sleep_mode(void) {
                    125000000,  // Restore to full speed
                    125000000);
 
-    sleep_ms(100); // Allow clocks to stabilize
+    if (ble) {
+        sleep_ms(100); // Allow clocks to stabilize
 
-    // blink to signal wake up
-    for (int i = 0; i < 5; i++) {
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-        sleep_ms(200);
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-        sleep_ms(200);
+        // blink to signal wake up
+        for (int i = 0; i < 5; i++) {
+            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+            sleep_ms(200);
+            cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+            sleep_ms(200);
+        }
     }
 
-    // Reset next_update to 7 seconds after waking
-    next_update = delayed_by_ms(get_absolute_time(), 7000);
+    // Still stationary (timer wake), give it a full inactivity period before sleeping again
+    if (gpio_get(ACCEL_INT2_PIN)) {
+        add_alarm_in_ms(LIS3_INACTIVITY_DURATION_MS, stationary_recheck_callback, NULL, true);
+    }
 }
 
-static void BLE_send_data(void) {
-    if (bme680_read_data(&data) || pmsa003_read_data(&pmsa_data)) {
-        ble_data.temperature = data.temperature;
-        ble_data.humidity = data.humidity;
-        ble_data.pressure = data.pressure;
-        ble_data.gas_resistance = data.gas_resistance;
-        ble_data.voc_ppm = data.voc_ppm;
-        ble_data.pm25 = (float) pmsa_data.pm2_5_env;
-        update_sensor_data(&ble_data);
+static void print_boot_timeline(void) {
+    printf("Boot timeline:");
+    for (int m = 0; m < BOOT_MILESTONE_COUNT; m++) {
+        if (boot_reached(m)) {
+            printf(" %s %lu ms,", boot_milestone_name(m), boot_milestone_ms(m));
+        }
     }
+    printf("\n");
 }
 
-static bool is_abnormal(void) {
-    int num_checks = 5;          // Number of checks to confirm abnormality
-    int delay_between_checks = 500;
-    int abnormal_count = 0;
-
-    printf("Checking for abnormal data...\n");
-
-    for (int i = 0; i < num_checks; i++) {
-        // Read sensor values directly
-        bme680_read_data(&data);
-        pmsa003_read_data(&pmsa_data);
-
-        // Perform your abnormality logic here
-        if ((float) pmsa_data.pm2_5_env > 12.0 || data.voc_ppm > 0.5) {
-            abnormal_count++;
-            /*printf("Check %d: Abnormal data detected\n", i + 1);
-            } else {
-                printf("Check %d: Data normal\n", i + 1);
-            }*/
-        }
+static void publish_sensor_data(const acq_sample_t *sample) {
+    if (sample->flags & ACQ_FLAG_AIR) {
+        data = sample->air;
+        // BLE payload keeps its float layout, converted once per update
+        ble_data.temperature = data.temperature / 100.0f;
+        ble_data.humidity = data.humidity / 1000.0f;
+        ble_data.pressure = (float) data.pressure;
+        ble_data.gas_resistance = data.gas_resistance / 1000.0f;  //kilo ohms
+        ble_data.voc_ppm = data.voc_ppb / 1000.0f;
+#if BME680_TRACE_OUTPUT
+        // replay format of test/test_iaq_replay.c
+        printf("trace:%lu,%lu,%lu\n", sample->timestamp_ms, data.gas_resistance, data.humidity);
+#endif
+    }
+    if (sample->flags & ACQ_FLAG_PM) {
+        pmsa_data = sample->pm;
+        ble_data.pm25 = (float) pmsa_data.pm2_5_env;
+    }
+    if (!(sample->flags & (ACQ_FLAG_AIR | ACQ_FLAG_PM))) {
+        return;
+    }
 
-        // Wait between checks (unless it's the last check)
-        if (i < num_checks - 1) {
-            sleep_ms(delay_between_checks);
-        }
+    // each sensor's bit follows its latest reading
+    uint8_t was_warming = ble_data.quality;
+    if (sample->flags & ACQ_FLAG_AIR) {
+        ble_data.quality = (ble_data.quality & ~BLE_QUALITY_AIR_WARMING)
+                           | ((sample->flags & ACQ_FLAG_AIR_WARMING) ? BLE_QUALITY_AIR_WARMING : 0);
+    }
+    if (sample->flags & ACQ_FLAG_PM) {
+        ble_data.quality = (ble_data.quality & ~BLE_QUALITY_PM_WARMING)
+                           | ((sample->flags & ACQ_FLAG_PM_WARMING) ? BLE_QUALITY_PM_WARMING : 0);
     }
+    update_sensor_data(&ble_data);
 
-    // Determine if abnormal data is confirmed
-    if (abnormal_count >= (num_checks / 2) + 1) {
-        //printf("Abnormal data confirmed after %d checks\n", num_checks);
-        return true; // Abnormal data detected
+    if ((was_warming & ~ble_data.quality) & BLE_QUALITY_AIR_WARMING) {
+        acq_stats_t acq_stats;
+        acquisition_get_stats(&acq_stats);
+        printf("BME680 ready after %lu ms (%s)\n", acq_stats.air_ready_ms,
+               acq_stats.air_ready_timed_out ? "upper bound" : "converged");
     }
 
-    //printf("Data deemed normal after %d checks\n", num_checks);
-    return false; // Data is normal
+    boot_mark(BOOT_FIRST_SAMPLE);
+    // both bits start set, so this waits for a ready reading from each sensor
+    if (!boot_reached(BOOT_FIRST_VALID) && ble_data.quality == 0) {
+        boot_mark(BOOT_FIRST_VALID);
+        print_boot_timeline();
+    }
+}
+
+// ends the temperature check started by a timer wake
+static void finish_check(anomaly_verdict_t verdict, uint32_t votes) {
+    uint32_t awake_ms = to_ms_since_boot(get_absolute_time()) - check_start_ms;
+    check_cycles++;
+    check_awake_ms += awake_ms;
+    printf("Temperature check: %s after %lu samples, %lu ms awake (average %lu ms over %lu checks)\n",
+           verdict == ANOMALY_CONFIRMED ? "abnormal" : "normal", votes,
+           awake_ms, check_awake_ms / check_cycles, check_cycles);
+    checking = false;
+
+    if (verdict == ANOMALY_CONFIRMED) {
+        printf("Abnormal data detected, waking up\n");
+        power_wake(true);
+        acquisition_wake(LIS3_RATE_IDLE);
+        awake = true;
+    } else {
+        // SEND BACK TO SLEEP
+        printf("No abnormal data detected, go back to sleep\n");
+        uart_default_tx_wait_blocking();
+        enter_sleep_mode();
+    }
 }
 
 int main() {
+    // before anything that can post events: interrupts, BLE, core1
+    event_loop_init();
+    work_queue_init();
+    accel_work_id = work_register(accel_work, "INT2");
+    int1_work_id = work_register(int1_work, "INT1");
+    wake_work_id = work_register(wake_timer_work, "Wake timer");
+    sleep_timer_init();
+
     if (!initialize_hardware()) {
         printf("Hardware initialization failed!\n");
         return -1;
     }
 
+    power_init();
     sleep_ms(100);
     printf("Device initialized!\n");
 
@@ -340,51 +490,142 @@ int main() {
         sleep_ms(200);
     }
 
-    next_update = get_absolute_time();
+    anomaly_init(&anomaly, ANOMALY_VOTES, ANOMALY_WINDOW);
+
+    // from here on core1 owns both I2C buses
+    acquisition_start(ACQ_SAMPLE_PERIOD_MS);
     uint32_t counter = 0;
 
+    // INT2 edges drive both sleep entry and wake-up
+    gpio_dispatch_add(ACCEL_INT2_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, &accel_interrupt_handler);
+    if (gpio_get(ACCEL_INT2_PIN)) {
+        add_alarm_in_ms(LIS3_INACTIVITY_DURATION_MS, stationary_recheck_callback, NULL, true);
+    }
+
     while (true) {
+        // the core sleeps in here until an interrupt, alarm or core1 posts something
+        uint32_t events = event_wait();
+
+        // interrupt bottom halves, the events they post come back on the next event_wait
+        if (events & EVENT_WORK) {
+            work_run();
+        }
+
         if (awake) {  // Active mode
-            //int pin_state = gpio_get(ACCEL_INT_PIN);
-            //printf("ACCEL_INT_PIN state: %d\n", pin_state);
-            if (check_no_movement_for_duration()) {
-                printf("No movement for 20 seconds, entering sleep mode.\n");1;
-                enter_sleep_mode();
-            } else {
-                //printf("Movement checking\n");
-                //periodically updating and sending sensor data through BLE
-                if (absolute_time_diff_us(get_absolute_time(), next_update) <= 0) {
-                    BLE_send_data();
+            if (events & EVENT_SAMPLE) {
+                // periodically sending sensor data from core1 through BLE
+                acq_sample_t sample;
+                while (acquisition_pop(&sample)) {
+                    publish_sensor_data(&sample);
+                    anomaly_update(&anomaly, &sample);
+                    if (sample.flags & ACQ_FLAG_SCAN) {
+                        printf("BME680 heater scan (ohms, * not heat-stable):");
+                        for (int i = 0; i < sample.scan.steps; i++) {
+                            printf(" %lu%s", sample.scan.gas_resistance[i],
+                                   (sample.scan.stable_mask & (1u << i)) ? "" : "*");
+                        }
+                        printf("\n");
+                    }
+                    if (!(sample.flags & ACQ_FLAG_AIR)) {
+                        continue;
+                    }
                     counter++;
                     printf("\n=== Active Mode - Loop iteration %lu ===\n", counter);
-                    next_update = delayed_by_ms(next_update, 7000); // set next time to send data
+
+                    lis3_governor_stats_t lis3_stats;
+                    LIS3_get_governor_stats(&lis3_stats);
+                    printf("LIS3 ODR transitions: %lu, time sleep/idle/classify: %lu/%lu/%lu ms\n",
+                           lis3_stats.transitions, lis3_stats.time_ms[LIS3_RATE_SLEEP],
+                           lis3_stats.time_ms[LIS3_RATE_IDLE], lis3_stats.time_ms[LIS3_RATE_CLASSIFY]);
+
+                    pm_scheduler_stats_t pm_stats;
+                    pm_scheduler_get_stats(&pm_stats);
+                    printf("PM fan duty cycle: %u.%u%% (%lu windows)\n",
+                           pm_stats.duty_permille / 10, pm_stats.duty_permille % 10, pm_stats.windows);
+                    printf("PM ready %lu ms after fan on in the last window (bound %u ms, %lu windows hit it)\n",
+                           pm_stats.last_ready_ms, PM_WINDOW_SPINUP_MS + PM_WINDOW_STABILISE_MS,
+                           pm_stats.ready_timeouts);
+
+                    printf("IAQ: %u (accuracy %u), VOC %lu ppb\n", data.iaq, data.iaq_accuracy, data.voc_ppb);
+
+                    bme680_bus_stats_t bme_stats;
+                    bme680_get_bus_stats(&bme_stats);
+                    if (bme_stats.samples > 0) {
+                        printf("BME680 per sample: %lu I2C transactions, %lu us bus time\n",
+                               bme_stats.transactions / bme_stats.samples, bme_stats.bus_us / bme_stats.samples);
+                    }
+
+                    print_i2c_dma_stats("i2c0", i2c0);
+                    print_i2c_dma_stats("i2c1", i2c1);
+                    print_i2c_device_stats();
+                    print_work_stats();
+                    print_power_stats();
+
+                    acq_stats_t acq_stats;
+                    acquisition_get_stats(&acq_stats);
+                    printf("Core1 samples: %lu produced, %lu dropped, queue peak %lu\n",
+                           acq_stats.produced, acq_stats.dropped, acq_stats.max_depth);
+                    print_i2c_cpu_per_sample(acq_stats.produced);
+                    printf("Motion: %lu bouts, %lu of %lu accelerometer samples moving\n",
+                           acq_stats.motion_bouts, acq_stats.motion_moving, acq_stats.motion_samples);
+
+                    event_loop_stats_t loop_stats;
+                    event_loop_take_stats(&loop_stats);
+                    printf("Core0 idle: %lu.%lu%%, %lu wakeups/s, %lu dispatches in %lu ms\n",
+                           loop_stats.idle_permille / 10, loop_stats.idle_permille % 10,
+                           loop_stats.wakeups_per_sec, loop_stats.dispatches, loop_stats.window_ms);
                 }
             }
+            if (events & EVENT_STATIONARY) {
+                printf("No movement for %d seconds, entering sleep mode.\n",
+                       LIS3_INACTIVITY_DURATION_MS / 1000);
+                enter_sleep_mode();
+            }
         } else {
-            //printf("Device is asleep\n");
-            if (movement_wake_up) {
-                leave_sleep_mode();
+            if (events & EVENT_MOTION) {
+                leave_sleep_mode(true);
+                checking = false;
+                acquisition_wake(LIS3_RATE_CLASSIFY);
                 awake = true; // wake up device
-                movement_wake_up = false; // disable flag
-            } else if (temp_check) {
-                // will blink LED 5 times after wake-up
-                leave_sleep_mode();
-                temp_check = false; // disable flag
-
-                printf("Sending data over BLE\n");
-                BLE_send_data();
-                if (is_abnormal()) { // check for abnormal data
-                    printf("Abnormal data detected, waking up\n");
-                    // already awake so just set to awake mode
-                    awake = true;
-                } else {
-                    // SEND BACK TO SLEEP
-                    printf("No abnormal data detected, go back to sleep\n");
-                    uart_default_tx_wait_blocking();
-                    enter_sleep_mode();
+            } else if (events & EVENT_WAKE_TIMER) {
+                check_start_ms = to_ms_since_boot(get_absolute_time());
+                leave_sleep_mode(false);
+
+                // samples arrive as EVENT_SAMPLE, the verdict comes from the vote
+                printf("Checking for abnormal data...\n");
+                anomaly_reset(&anomaly);
+                acquisition_check(ANOMALY_WINDOW);
+                checking = true;
+            }
+            if (checking && (events & EVENT_SAMPLE)) {
+                // each sample also goes out over BLE as it arrives
+                acq_sample_t sample;
+                while (checking && acquisition_pop(&sample)) {
+                    publish_sensor_data(&sample);
+                    anomaly_verdict_t verdict = anomaly_update(&anomaly, &sample);
+                    // failed measurements leave the vote short, treat that as normal
+                    if (verdict == ANOMALY_PENDING && (sample.flags & ACQ_FLAG_CHECK_DONE)) {
+                        verdict = ANOMALY_NORMAL;
+                    }
+                    if (verdict != ANOMALY_PENDING) {
+                        finish_check(verdict, anomaly.filled);
+                    }
                 }
             }
         }
+
+        if (events & EVENT_BLE) {
+            if (power_ble_event()) {
+                power_stats_t power_stats;
+                power_get_stats(&power_stats);
+                printf("BLE advertising %lu ms after wake (max %lu ms over %lu restarts)\n",
+                       power_stats.last_advertise_ms, power_stats.max_advertise_ms, power_stats.ble_restarts);
+            }
+            if (ble_is_connected() != ble_client) {
+                ble_client = ble_is_connected();
+                printf("BLE client %s\n", ble_client ? "connected" : "disconnected");
+            }
+        }
     }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "power_manager.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/sleep.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/scb.h"
+#include "ble_service.h"
+
+static power_tier_t tier;
+static uint64_t tier_since_us;
+static bool ble_running;
+static bool restart_pending;    // waiting for advertising after a BLE restart
+static uint64_t wake_us;
+static power_stats_t stats;
+
+static const char *tier_names[POWER_TIER_COUNT] = { "active", "light", "deep" };
+
+static void set_tier(power_tier_t next) {
+    uint64_t now = time_us_64();
+    stats.time_ms[tier] += (uint32_t) ((now - tier_since_us) / 1000);
+    stats.entries[next]++;
+    tier = next;
+    tier_since_us = now;
+}
+
+void power_init(void) {
+    tier = POWER_TIER_ACTIVE;
+    tier_since_us = time_us_64();
+    ble_running = true;
+    stats.entries[POWER_TIER_ACTIVE] = 1;
+}
+
+void power_enter_light(void) {
+    set_tier(POWER_TIER_LIGHT);
+}
+
+void power_enter_deep(void) {
+    if (ble_running) {
+        stop_ble_service();
+        ble_running = false;
+        restart_pending = false;
+    }
+
+    // XOSC for clk_ref/clk_sys/clk_peri, USB and ADC clocks and both PLLs off
+    sleep_run_from_dormant_source(DORMANT_SOURCE_XOSC);
+
+    // while both cores sleep only the timer and the GPIO bank stay clocked,
+    // the sleep timer alarm and the accelerometer pins are the wake sources
+    clocks_hw->sleep_en0 = CLOCKS_SLEEP_EN0_CLK_SYS_IO_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_PADS_BITS;
+    clocks_hw->sleep_en1 = CLOCKS_SLEEP_EN1_CLK_SYS_TIMER_BITS;
+    scb_hw->scr |= ARM_CPU_PREFIXED(SCR_SLEEPDEEP_BITS);
+
+    set_tier(POWER_TIER_DEEP);
+}
+
+void power_wake(bool ble) {
+    uint64_t now = time_us_64();
+    if (tier == POWER_TIER_DEEP) {
+        scb_hw->scr &= ~ARM_CPU_PREFIXED(SCR_SLEEPDEEP_BITS);
+        sleep_power_up(); // PLLs, clk_sys and the sleep enables back to their defaults
+    }
+    if (tier != POWER_TIER_ACTIVE) {
+        set_tier(POWER_TIER_ACTIVE);
+    }
+
+    // a timer check stays radio-off until it decides to keep the device awake,
+    // so the latency is measured from the call that restarts BLE
+    if (ble && !ble_running) {
+        if (start_ble_service() == 0) {
+            ble_running = true;
+            restart_pending = true;
+            wake_us = now;
+            stats.ble_restarts++;
+        } else {
+            printf("BLE restart failed\n");
+        }
+    }
+}
+
+power_tier_t power_get_tier(void) {
+    return tier;
+}
+
+bool power_ble_running(void) {
+    return ble_running;
+}
+
+bool power_ble_event(void) {
+    if (!restart_pending || !ble_is_advertising()) {
+        return false;
+    }
+    restart_pending = false;
+    uint32_t ms = ble_advertising_since_ms() - (uint32_t) (wake_us / 1000);
+    stats.last_advertise_ms = ms;
+    if (ms > stats.max_advertise_ms) {
+        stats.max_advertise_ms = ms;
+    }
+    return true;
+}
+
+void power_get_stats(power_stats_t *out) {
+    *out = stats;
+    out->time_ms[tier] += (uint32_t) ((time_us_64() - tier_since_us) / 1000);
+}
+
+const char *power_tier_name(power_tier_t t) {
+    return t < POWER_TIER_COUNT ? tier_names[t] : "?";
+}
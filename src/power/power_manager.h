@@ -0,0 +1,54 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Power tiers of core0 between measurements, from highest to lowest current.
+// LIGHT keeps the radio advertising and only slows clk_peri. DEEP stops BLE,
+// runs the system from the crystal with both PLLs off and lets the chip
+// clock-gate everything but the timer and the GPIO bank while the main loop
+// waits, so the sleep timer and the accelerometer pins still wake it.
+
+typedef enum {
+    POWER_TIER_ACTIVE,
+    POWER_TIER_LIGHT,
+    POWER_TIER_DEEP,
+    POWER_TIER_COUNT
+} power_tier_t;
+
+typedef struct {
+    uint32_t entries[POWER_TIER_COUNT];
+    uint32_t time_ms[POWER_TIER_COUNT];
+    uint32_t ble_restarts;
+    uint32_t last_advertise_ms;     // wake to advertising, last BLE restart
+    uint32_t max_advertise_ms;
+} power_stats_t;
+
+// starts in POWER_TIER_ACTIVE with BLE running
+void power_init(void);
+
+void power_enter_light(void);
+
+// stops BLE; only call while no client is connected and after
+// acquisition_sleep() confirmed that core1 is off the I2C buses
+void power_enter_deep(void);
+
+// back to full clocks from either sleep tier; with ble the radio is
+// restarted if the deep tier stopped it. Call before sending core1 the
+// command that ends its idle state, the clock switch must not overlap I2C.
+void power_wake(bool ble);
+
+power_tier_t power_get_tier(void);
+
+bool power_ble_running(void);
+
+// call on EVENT_BLE, returns true once a restart reached advertising and
+// last_advertise_ms holds the new measurement
+bool power_ble_event(void);
+
+void power_get_stats(power_stats_t *stats);
+
+const char *power_tier_name(power_tier_t tier);
+
+#endif //POWER_MANAGER_H
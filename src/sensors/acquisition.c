@@ -0,0 +1,350 @@
+#include "acquisition.h"
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "pm_scheduler.h"
+#include "readiness.h"
+#include "motion.h"
+#include "utils/circular_buffer.h"
+#include "utils/event_loop.h"
+#include "utils/i2c_dma.h"
+#include "config/config.h"
+#include "config/pin_config.h"
+
+// commands are a single SIO FIFO word: command in the low byte, argument above
+typedef enum {
+    ACQ_CMD_WAKE,
+    ACQ_CMD_SLEEP,
+    ACQ_CMD_CHECK
+} acq_command_t;
+
+#define ACQ_CMD(cmd, arg)   ((uint32_t) (cmd) | ((uint32_t) (arg) << 8))
+
+// core1 to core0: all bus traffic finished after a SLEEP command
+#define ACQ_IDLE_ACK        0x51ee0000u
+
+static acq_sample_t ring_storage[ACQ_QUEUE_DEPTH];
+static circular_buffer_t ring;
+
+// owned by core1 once started
+static uint32_t sample_period_ms;
+static bool sampling;
+static absolute_time_t next_sample;
+static uint8_t check_remaining;
+static absolute_time_t next_check;
+static gas_readiness_t gas_ready;
+static bool heater_cold;                        // slept since the last readiness restart
+static motion_engine_t motion;
+static bool motion_fifo;                        // accelerometer streaming through its FIFO
+static absolute_time_t next_motion_poll;
+static volatile uint32_t air_ready_ms;          // last time to ready, boot or wake
+static volatile bool air_ready_timed_out;
+static volatile uint32_t produced;
+static volatile uint32_t dropped;
+
+// owned by core0
+static uint32_t max_depth;
+
+static void push_sample(acq_sample_t *sample) {
+    sample->timestamp_ms = to_ms_since_boot(get_absolute_time());
+    if ((sample->flags & ACQ_FLAG_AIR) && !readiness_ready(&gas_ready.r)) {
+        if (gas_readiness_update(&gas_ready, sample->air.gas_resistance, sample->air.gas_stable,
+                                 sample->timestamp_ms)) {
+            air_ready_ms = gas_ready.r.ready_ms;
+            air_ready_timed_out = gas_ready.r.state == READINESS_TIMED_OUT;
+        } else {
+            sample->flags |= ACQ_FLAG_AIR_WARMING;
+        }
+    }
+    bool pm_ready = (sample->flags & ACQ_FLAG_CHECK) ? pm_scheduler_check_ready() : pm_scheduler_ready();
+    if ((sample->flags & ACQ_FLAG_PM) && !pm_ready) {
+        sample->flags |= ACQ_FLAG_PM_WARMING;
+    }
+    if (circular_buffer_push(&ring, sample)) {
+        produced++;
+    } else {
+        dropped++;
+    }
+    event_post(EVENT_SAMPLE);
+}
+
+static void bme_result_callback(bool ok, const air_quality_t *result, void *user_data) {
+    if (!ok) {
+        return;
+    }
+    acq_sample_t sample = { .flags = ACQ_FLAG_AIR, .air = *result };
+    push_sample(&sample);
+}
+
+#if BME680_SCAN_EVERY
+static uint32_t sample_periods;
+
+static void scan_result_callback(bool ok, const bme680_scan_t *scan, void *user_data) {
+    if (!ok) {
+        return;
+    }
+    acq_sample_t sample = { .flags = ACQ_FLAG_SCAN, .scan = *scan };
+    push_sample(&sample);
+}
+
+static const bme680_heater_profile_t scan_profile = {
+    .steps = BME680_SCAN_STEPS,
+    .temp_c = BME680_SCAN_TEMPS_C,
+    .dur_ms = BME680_SCAN_DUR_MS
+};
+#endif
+
+// every BME680_SCAN_EVERY-th period the set-point scan takes the place of the sample
+static void start_air_sample(void) {
+#if BME680_SCAN_EVERY
+    if (++sample_periods % BME680_SCAN_EVERY == 0) {
+        bme680_start_scan(&scan_profile, scan_result_callback, NULL);
+        return;
+    }
+#endif
+    bme680_start_measurement(bme_result_callback, NULL);
+}
+
+// the heater cools down while asleep, the first wake after it settles again
+static void restart_gas_readiness(uint32_t max_ms) {
+    gas_readiness_start(&gas_ready, to_ms_since_boot(get_absolute_time()), max_ms);
+    heater_cold = false;
+}
+
+// every attempt of a check burst produces a sample, so the burst always ends
+static void check_result_callback(bool ok, const air_quality_t *result, void *user_data) {
+    if (check_remaining == 0) {
+        return; // burst cancelled while the heater was on
+    }
+    acq_sample_t sample = { .flags = ACQ_FLAG_CHECK };
+    if (ok) {
+        sample.flags |= ACQ_FLAG_AIR;
+        sample.air = *result;
+    }
+    // the fan has been running since the pre-wake, a duplicate frame is left out
+    if (pmsa003_read_frame(&sample.pm) == PMSA003_OK) {
+        sample.flags |= ACQ_FLAG_PM;
+        pm_scheduler_observe(&sample.pm);
+    }
+    if (--check_remaining == 0) {
+        sample.flags |= ACQ_FLAG_CHECK_DONE;
+    }
+    push_sample(&sample);
+}
+
+static void check_poll(void) {
+    bme680_poll();
+    if (check_remaining == 0 || bme680_busy()
+            || absolute_time_diff_us(get_absolute_time(), next_check) > 0) {
+        return;
+    }
+    next_check = make_timeout_time_ms(ACQ_CHECK_PERIOD_MS);
+    if (!bme680_start_measurement(check_result_callback, NULL)) {
+        check_result_callback(false, NULL, NULL);
+    }
+}
+
+// until the heater is done or the next burst sample is due
+static uint64_t check_wait_us(void) {
+    absolute_time_t next = bme680_busy() ? bme680_ready_time() : next_check;
+    int64_t us = absolute_time_diff_us(get_absolute_time(), next);
+    if (us < ACQ_CHECK_MIN_WAIT_US) {
+        return ACQ_CHECK_MIN_WAIT_US;
+    }
+    return us < ACQ_POLL_INTERVAL_MS * 1000ll ? (uint64_t) us : ACQ_POLL_INTERVAL_MS * 1000ull;
+}
+
+// core1's own GPIO interrupt; the pin is only enabled on core1 while the
+// FIFO owns INT1, core0 listens to it for the IA1 wake-up in the deep tier
+static void int1_fifo_irq(uint gpio, uint32_t events) {
+    LIS3_fifo_notify();
+}
+
+// CLASSIFY streams samples through the FIFO into the motion engine, the
+// slower rates leave INT1 to the IA1 wake-up
+static void sync_motion_fifo(void) {
+    bool want = LIS3_get_rate_state() == LIS3_RATE_CLASSIFY;
+    if (want == motion_fifo) {
+        return;
+    }
+    if (want) {
+        motion_enter_bout(&motion);
+        LIS3_fifo_enable(LIS3_FIFO_WATERMARK, motion_fifo_callback, &motion);
+        gpio_set_irq_enabled(ACCEL_INT_PIN, GPIO_IRQ_EDGE_RISE, true);
+    } else {
+        gpio_set_irq_enabled(ACCEL_INT_PIN, GPIO_IRQ_EDGE_RISE, false);
+        LIS3_fifo_disable();
+    }
+    motion_fifo = want;
+}
+
+// below the classify rate the engine gets a polled sample instead of FIFO
+// batches; motion raises the rate so the FIFO takes over
+static void motion_poll(void) {
+    if (motion_fifo || absolute_time_diff_us(get_absolute_time(), next_motion_poll) > 0) {
+        return;
+    }
+    next_motion_poll = make_timeout_time_ms(LIS3_MOTION_POLL_MS);
+
+    lis3_raw_t raw;
+    if (LIS3_read_raw(&raw) && motion_update(&motion, &raw)) {
+        LIS3_set_rate_state(LIS3_RATE_CLASSIFY);
+    }
+}
+
+// a PMSA003 prefetch may still be streaming in on i2c1, the poll bounds it by the device timeout
+static void wait_buses_idle(void) {
+    while (i2c_dma_busy(i2c0) || i2c_dma_busy(i2c1)) {
+        i2c_dma_poll(i2c0);
+        i2c_dma_poll(i2c1);
+        tight_loop_contents();
+    }
+}
+
+static void handle_command(uint32_t word) {
+    switch ((acq_command_t) (word & 0xFF)) {
+        case ACQ_CMD_WAKE:
+            if (heater_cold) {
+                restart_gas_readiness(BME680_WAKE_READY_MAX_MS);
+            }
+            check_remaining = 0;
+            LIS3_set_rate_state((lis3_rate_state_t) (word >> 8));
+            sync_motion_fifo();
+            pm_scheduler_resume();
+            sampling = true;
+            next_sample = make_timeout_time_ms(sample_period_ms);
+            break;
+
+        case ACQ_CMD_SLEEP:
+            sampling = false;
+            check_remaining = 0;
+            bme680_cancel_scan();
+            heater_cold = true;
+            pm_scheduler_suspend();
+            LIS3_set_rate_state(LIS3_RATE_SLEEP);
+            sync_motion_fifo();
+            // core0 may change the system clocks once this arrives; core1
+            // stays off the buses in the FIFO wait until the next command
+            wait_buses_idle();
+            multicore_fifo_push_blocking(ACQ_IDLE_ACK);
+            break;
+
+        case ACQ_CMD_CHECK:
+            sampling = false;
+            bme680_cancel_scan();
+            check_remaining = (uint8_t) (word >> 8);
+            next_check = get_absolute_time();
+            if (heater_cold) {
+                restart_gas_readiness(BME680_WAKE_READY_MAX_MS);
+            }
+            break;
+    }
+}
+
+static void core1_main(void) {
+    // core1 issues every transfer from here on, so it takes the completions
+    i2c_dma_irq_enable(true);
+    // GPIO callbacks and interrupt enables are per core
+    gpio_set_irq_callback(int1_fifo_irq);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    while (true) {
+        if (!sampling && check_remaining == 0) {
+            // nothing to do until core0 asks, the FIFO pop waits in __wfe
+            handle_command(multicore_fifo_pop_blocking());
+            continue;
+        }
+
+        uint64_t wait_us = ACQ_POLL_INTERVAL_MS * 1000ull;
+        if (sampling) {
+            // the PMSA003 frame streams in on i2c1 while i2c0 is busy below
+            if (pm_scheduler_frame_due()) {
+                pmsa003_prefetch();
+            }
+            motion_poll();
+            LIS3_governor_poll();
+            sync_motion_fifo();
+            if (LIS3_fifo_pending() && LIS3_fifo_drain() > 0 && !motion_in_bout(&motion)) {
+                // the batches show the device still again, no need to wait out the hold time
+                LIS3_set_rate_state(LIS3_RATE_IDLE);
+                sync_motion_fifo();
+            }
+
+            acq_sample_t sample = { .flags = ACQ_FLAG_PM };
+            if (pm_scheduler_poll(&sample.pm)) {
+                push_sample(&sample);
+            }
+
+            // the result is pushed from bme_result_callback once the heater is done
+            bme680_poll();
+            if (absolute_time_diff_us(get_absolute_time(), next_sample) <= 0) {
+                start_air_sample();
+                next_sample = delayed_by_ms(next_sample, sample_period_ms);
+            }
+        } else {
+            check_poll();
+            wait_us = check_wait_us();
+        }
+
+        // a transfer stuck past its timeout is aborted and the bus cleared
+        i2c_dma_poll(i2c0);
+        i2c_dma_poll(i2c1);
+
+        // sleeps until the next poll unless core0 sends a command first
+        uint32_t word;
+        if (multicore_fifo_pop_timeout_us(wait_us, &word)) {
+            handle_command(word);
+        }
+    }
+}
+
+void acquisition_start(uint32_t period_ms) {
+    circular_buffer_init(&ring, ring_storage, sizeof(acq_sample_t), ACQ_QUEUE_DEPTH);
+    sample_period_ms = period_ms;
+    sampling = true;
+    next_sample = get_absolute_time();
+    restart_gas_readiness(BME680_BOOT_READY_MAX_MS);
+    motion_init(&motion, LIS3_MOTION_THRESHOLD_MG, LIS3_MOTION_STILL_SAMPLES);
+    i2c_dma_irq_enable(false);
+    multicore_launch_core1(core1_main);
+}
+
+bool acquisition_pop(acq_sample_t *sample) {
+    uint32_t depth = circular_buffer_count(&ring);
+    if (depth > max_depth) {
+        max_depth = depth;
+    }
+    return circular_buffer_pop(&ring, sample);
+}
+
+void acquisition_wake(lis3_rate_state_t rate) {
+    multicore_fifo_push_blocking(ACQ_CMD(ACQ_CMD_WAKE, rate));
+}
+
+bool acquisition_sleep(void) {
+    // an acknowledgement that arrived after an earlier timeout
+    while (multicore_fifo_rvalid()) {
+        multicore_fifo_pop_blocking();
+    }
+    multicore_fifo_push_blocking(ACQ_CMD(ACQ_CMD_SLEEP, 0));
+
+    uint32_t word;
+    return multicore_fifo_pop_timeout_us(ACQ_IDLE_ACK_TIMEOUT_MS * 1000ull, &word) && word == ACQ_IDLE_ACK;
+}
+
+void acquisition_check(uint8_t samples) {
+    multicore_fifo_push_blocking(ACQ_CMD(ACQ_CMD_CHECK, samples));
+}
+
+void acquisition_get_stats(acq_stats_t *stats) {
+    stats->air_ready_ms = air_ready_ms;
+    stats->air_ready_timed_out = air_ready_timed_out;
+    stats->produced = produced;
+    stats->dropped = dropped;
+    stats->max_depth = max_depth;
+    stats->motion_samples = motion.samples;
+    stats->motion_moving = motion.moving_samples;
+    stats->motion_bouts = motion.bouts;
+}
@@ -0,0 +1,66 @@
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bme680.h"
+#include "pmsa003.h"
+#include "lis3.h"
+
+// Sensor acquisition on core1. After acquisition_start() core1 owns i2c0
+// (LIS3DH, BME680) and i2c1 (PMSA003); core0 must not call the drivers'
+// bus functions any more and instead sends commands through the SIO FIFO.
+// Samples come back through a lock-free SPSC ring, so core0 only runs
+// BLE and power management and never waits on a sensor.
+
+#define ACQ_FLAG_AIR        0x01    // air holds a valid BME680 result
+#define ACQ_FLAG_PM         0x02    // pm holds a valid PMSA003 reading
+#define ACQ_FLAG_SCAN       0x04    // scan holds a completed BME680 heater scan
+#define ACQ_FLAG_CHECK      0x08    // part of an acquisition_check() burst
+#define ACQ_FLAG_CHECK_DONE 0x10    // last sample of the burst
+#define ACQ_FLAG_AIR_WARMING 0x20   // BME680 gas reading still settling after boot or wake
+#define ACQ_FLAG_PM_WARMING 0x40    // PMSA003 readings not settled since the fan was switched on
+
+typedef struct {
+    uint32_t timestamp_ms;      // time since boot when the reading completed
+    uint8_t flags;
+    air_quality_t air;
+    pmsa003_data_t pm;
+    bme680_scan_t scan;
+} acq_sample_t;
+
+typedef struct {
+    uint32_t produced;          // samples pushed by core1
+    uint32_t dropped;           // samples lost because the ring was full
+    uint32_t max_depth;         // highest ring occupancy seen by core0
+    uint32_t air_ready_ms;      // BME680 start to settled gas reading, latest boot or wake
+    bool air_ready_timed_out;   // air_ready_ms is the fallback bound, the reading never settled
+    uint32_t motion_samples;    // accelerometer samples through the motion engine, polled and FIFO
+    uint32_t motion_moving;     // of those above the motion threshold
+    uint32_t motion_bouts;
+} acq_stats_t;
+
+// launches the acquisition loop on core1, sensors must already be initialised;
+// samples are flagged as warming until each sensor's readings have settled
+void acquisition_start(uint32_t sample_period_ms);
+
+// core0: next sample, false if none is waiting
+bool acquisition_pop(acq_sample_t *sample);
+
+// periodic sampling with the accelerometer at the given rate and PM windows running
+void acquisition_wake(lis3_rate_state_t rate);
+
+// stops sampling, PM fan off and the accelerometer at its sleep rate; waits
+// until core1 has no I2C transfer left and returns false if it did not
+// confirm within ACQ_IDLE_ACK_TIMEOUT_MS. Only after a true return may core0
+// change clk_sys or clk_peri, core1 then stays idle until the next command.
+bool acquisition_sleep(void);
+
+// while sampling is stopped: BME680 measurements (with the newest PM frame)
+// every ACQ_CHECK_PERIOD_MS, pushed as they complete; each of the n attempts
+// yields a sample, failed ones without ACQ_FLAG_AIR. Waking or sleeping cancels it.
+void acquisition_check(uint8_t samples);
+
+void acquisition_get_stats(acq_stats_t *stats);
+
+#endif //ACQUISITION_H
@@ -0,0 +1,56 @@
+#include "anomaly.h"
+#include "aq_tables.h"
+#include "config/config.h"
+
+void anomaly_init(anomaly_detector_t *det, uint8_t votes_needed, uint8_t window) {
+    if (window == 0 || window > ANOMALY_MAX_WINDOW) {
+        window = ANOMALY_MAX_WINDOW;
+    }
+    if (votes_needed == 0 || votes_needed > window) {
+        votes_needed = window / 2 + 1;
+    }
+    det->window = window;
+    det->votes_needed = votes_needed;
+    anomaly_reset(det);
+}
+
+void anomaly_reset(anomaly_detector_t *det) {
+    det->filled = 0;
+    det->history = 0;
+    det->have_pm = false;
+    det->pm_aqi = 0;
+}
+
+// VOC is relative to the learned baseline, ignore it during burn-in
+static bool sample_abnormal(const anomaly_detector_t *det, const air_quality_t *air) {
+    return (det->have_pm && det->pm_aqi > AQI_ABNORMAL_THRESHOLD) ||
+           (air->iaq_accuracy >= IAQ_ACCURACY_LOW && air->voc_ppb > ANOMALY_VOC_PPB);
+}
+
+anomaly_verdict_t anomaly_update(anomaly_detector_t *det, const acq_sample_t *sample) {
+    // a PM reading from a fan that has not stabilised would vote on noise
+    if ((sample->flags & ACQ_FLAG_PM) && !(sample->flags & ACQ_FLAG_PM_WARMING)) {
+        det->pm_aqi = aq_pm_aqi(sample->pm.pm2_5_env, sample->pm.pm10_env);
+        det->have_pm = true;
+    }
+    if (sample->flags & ACQ_FLAG_AIR) {
+        uint32_t mask = det->window == 32 ? 0xFFFFFFFFu : (1u << det->window) - 1;
+        det->history = ((det->history << 1) | sample_abnormal(det, &sample->air)) & mask;
+        if (det->filled < det->window) {
+            det->filled++;
+        }
+    }
+    return anomaly_verdict(det);
+}
+
+anomaly_verdict_t anomaly_verdict(const anomaly_detector_t *det) {
+    uint32_t abnormal = (uint32_t) __builtin_popcount(det->history);
+    if (abnormal >= det->votes_needed) {
+        return ANOMALY_CONFIRMED;
+    }
+    // the votes still to come cannot reach k
+    if (abnormal + (det->window - det->filled) < det->votes_needed) {
+        return ANOMALY_NORMAL;
+    }
+    return ANOMALY_PENDING;
+}
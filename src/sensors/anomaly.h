@@ -0,0 +1,41 @@
+#ifndef ANOMALY_H
+#define ANOMALY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "acquisition.h"
+
+// Streaming k-of-n anomaly check over the samples coming out of the
+// acquisition ring. Every sample with a BME680 result casts one vote using
+// it and the latest PM reading; the verdict is decided as soon as k votes
+// are abnormal or k can no longer be reached, so a clear case needs fewer
+// than n samples. O(1) per sample, no sensor reads of its own.
+
+#define ANOMALY_MAX_WINDOW      32
+
+typedef enum {
+    ANOMALY_PENDING,        // not enough votes either way yet
+    ANOMALY_NORMAL,
+    ANOMALY_CONFIRMED
+} anomaly_verdict_t;
+
+typedef struct {
+    uint8_t window;         // n
+    uint8_t votes_needed;   // k
+    uint8_t filled;         // votes in the window, up to n
+    uint32_t history;       // one bit per vote, newest in bit 0, 1 = abnormal
+    uint16_t pm_aqi;        // from the latest PM reading
+    bool have_pm;
+} anomaly_detector_t;
+
+// k of the last n votes confirm an anomaly, n up to ANOMALY_MAX_WINDOW
+void anomaly_init(anomaly_detector_t *det, uint8_t votes_needed, uint8_t window);
+
+// drops all votes, e.g. when a new check starts after sleep
+void anomaly_reset(anomaly_detector_t *det);
+
+anomaly_verdict_t anomaly_update(anomaly_detector_t *det, const acq_sample_t *sample);
+
+anomaly_verdict_t anomaly_verdict(const anomaly_detector_t *det);
+
+#endif //ANOMALY_H
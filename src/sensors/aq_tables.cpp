@@ -0,0 +1,20 @@
+#include "aq_tables.h"
+#include "aq_tables.hpp"
+
+uint16_t aq_pm25_aqi(uint32_t pm25_x10) {
+    return (uint16_t) aq::interpolate(aq::pm25_aqi_table, pm25_x10);
+}
+
+uint16_t aq_pm10_aqi(uint32_t pm10_x10) {
+    return (uint16_t) aq::interpolate(aq::pm10_aqi_table, pm10_x10);
+}
+
+uint16_t aq_pm_aqi(uint16_t pm25, uint16_t pm10) {
+    uint16_t a = aq_pm25_aqi(pm25 * 10u);
+    uint16_t b = aq_pm10_aqi(pm10 * 10u);
+    return a > b ? a : b;
+}
+
+uint32_t aq_voc_ppb(uint32_t ratio_q8) {
+    return aq::interpolate(aq::voc_table, ratio_q8);
+}
@@ -0,0 +1,26 @@
+#ifndef AQ_TABLES_H
+#define AQ_TABLES_H
+
+#include <stdint.h>
+
+// C entry points for the compile-time conversion tables in aq_tables.hpp
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// EPA AQI from concentrations in ug/m3 x10, saturating at 500
+uint16_t aq_pm25_aqi(uint32_t pm25_x10);
+uint16_t aq_pm10_aqi(uint32_t pm10_x10);
+
+// overall particulate AQI from whole ug/m3 as the PMSA003 reports them
+uint16_t aq_pm_aqi(uint16_t pm25, uint16_t pm10);
+
+// VOC estimate in ppb from the baseline / gas resistance ratio in Q8
+uint32_t aq_voc_ppb(uint32_t ratio_q8);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //AQ_TABLES_H
@@ -0,0 +1,177 @@
+#ifndef AQ_TABLES_HPP
+#define AQ_TABLES_HPP
+
+// Conversion tables built at compile time from the published breakpoints.
+// Each table is sampled on a power-of-two grid so a lookup is a shift, a
+// mask and one multiply, with no branches on the segment. C code uses the
+// wrappers declared in aq_tables.h.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#include "iaq.h"
+}
+
+namespace aq {
+
+struct breakpoint {
+    uint32_t c_lo, c_hi;    // concentration x10, inclusive
+    uint16_t i_lo, i_hi;    // index range
+};
+
+// EPA AQI breakpoints, 2024 revision, concentrations in ug/m3 x10
+constexpr std::array<breakpoint, 6> pm25_breakpoints = {{
+    {0, 90, 0, 50},
+    {91, 354, 51, 100},
+    {355, 554, 101, 150},
+    {555, 1254, 151, 200},
+    {1255, 2254, 201, 300},
+    {2255, 3254, 301, 500},
+}};
+
+constexpr std::array<breakpoint, 6> pm10_breakpoints = {{
+    {0, 540, 0, 50},
+    {550, 1540, 51, 100},
+    {1550, 2540, 101, 150},
+    {2550, 3540, 151, 200},
+    {3550, 4240, 201, 300},
+    {4250, 6040, 301, 500},
+}};
+
+template <std::size_t N>
+constexpr bool breakpoints_valid(const std::array<breakpoint, N> &bp) {
+    if (bp[0].c_lo != 0 || bp[0].i_lo != 0 || bp[N - 1].i_hi != 500) {
+        return false;
+    }
+    for (std::size_t i = 0; i < N; i++) {
+        if (bp[i].c_hi <= bp[i].c_lo || bp[i].i_hi <= bp[i].i_lo) {
+            return false;
+        }
+        // segments follow each other without overlap, the index steps by one
+        if (i > 0 && (bp[i].c_lo <= bp[i - 1].c_hi || bp[i].i_lo != bp[i - 1].i_hi + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(breakpoints_valid(pm25_breakpoints), "PM2.5 breakpoints must be contiguous");
+static_assert(breakpoints_valid(pm10_breakpoints), "PM10 breakpoints must be contiguous");
+
+// EPA equation, rounded to the nearest integer; above the last segment the index saturates
+template <std::size_t N>
+constexpr uint16_t aqi_at(const std::array<breakpoint, N> &bp, uint32_t c) {
+    for (std::size_t i = 0; i < N; i++) {
+        const breakpoint &b = bp[i];
+        if (c <= b.c_hi) {
+            if (c < b.c_lo) {
+                return b.i_lo;  // between two segments' x10 bounds, never hit by integer input
+            }
+            uint32_t num = (uint32_t) (b.i_hi - b.i_lo) * (c - b.c_lo);
+            uint32_t den = b.c_hi - b.c_lo;
+            return (uint16_t) (b.i_lo + (num + den / 2) / den);
+        }
+    }
+    return bp[N - 1].i_hi;
+}
+
+// Samples f on a grid of 2^shift input units, one extra entry closes the last interval
+template <typename T, std::size_t N, typename F>
+constexpr std::array<T, N> sample_grid(unsigned shift, F f) {
+    std::array<T, N> table{};
+    for (std::size_t i = 0; i < N; i++) {
+        table[i] = f((uint32_t) i << shift);
+    }
+    return table;
+}
+
+template <typename T, std::size_t N>
+constexpr bool non_decreasing(const std::array<T, N> &table) {
+    for (std::size_t i = 1; i < N; i++) {
+        if (table[i] < table[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the last grid point at or above the domain end holds the saturated value,
+// one more entry past it keeps y[i + 1] in range
+template <typename T, std::size_t N>
+struct grid_table {
+    unsigned shift;
+    std::array<T, N> y;
+
+    constexpr uint32_t x_max() const { return (uint32_t) (N - 2) << shift; }
+};
+
+constexpr unsigned PM_SHIFT = 3;    // 0.8 ug/m3 grid
+
+constexpr std::size_t grid_size(uint32_t x_max, unsigned shift) {
+    return ((x_max + (1u << shift) - 1) >> shift) + 2;
+}
+
+constexpr uint32_t PM25_MAX = 3254;
+constexpr uint32_t PM10_MAX = 6040;
+
+constexpr grid_table<uint16_t, grid_size(PM25_MAX, PM_SHIFT)> pm25_aqi_table = {
+    PM_SHIFT,
+    sample_grid<uint16_t, grid_size(PM25_MAX, PM_SHIFT)>(PM_SHIFT,
+        [](uint32_t c) { return aqi_at(pm25_breakpoints, c); })
+};
+
+constexpr grid_table<uint16_t, grid_size(PM10_MAX, PM_SHIFT)> pm10_aqi_table = {
+    PM_SHIFT,
+    sample_grid<uint16_t, grid_size(PM10_MAX, PM_SHIFT)>(PM_SHIFT,
+        [](uint32_t c) { return aqi_at(pm10_breakpoints, c); })
+};
+
+static_assert(non_decreasing(pm25_aqi_table.y), "PM2.5 AQI table must be monotonic");
+static_assert(non_decreasing(pm10_aqi_table.y), "PM10 AQI table must be monotonic");
+static_assert(pm25_aqi_table.y[0] == 0 && pm25_aqi_table.y.back() == 500, "PM2.5 AQI table must span 0-500");
+static_assert(pm10_aqi_table.y[0] == 0 && pm10_aqi_table.y.back() == 500, "PM10 AQI table must span 0-500");
+
+// VOC estimate against the baseline/gas resistance ratio (Q8): metal oxide
+// sensors follow roughly R ~ C^-0.5, so the concentration goes with the ratio squared
+constexpr unsigned VOC_SHIFT = 6;   // 0.25 ratio steps
+
+constexpr uint32_t voc_at(uint32_t ratio_q8) {
+    uint64_t voc = ((uint64_t) IAQ_VOC_CLEAN_PPB * ratio_q8 * ratio_q8) >> 16;
+    return voc > IAQ_VOC_MAX_PPB ? IAQ_VOC_MAX_PPB : (uint32_t) voc;
+}
+
+constexpr grid_table<uint32_t, grid_size(IAQ_RATIO_MAX_Q8, VOC_SHIFT)> voc_table = {
+    VOC_SHIFT,
+    sample_grid<uint32_t, grid_size(IAQ_RATIO_MAX_Q8, VOC_SHIFT)>(VOC_SHIFT, voc_at)
+};
+
+static_assert(non_decreasing(voc_table.y), "VOC curve must grow as resistance drops");
+static_assert(voc_table.y[256 >> VOC_SHIFT] == IAQ_VOC_CLEAN_PPB, "ratio 1.0 must map to the clean-air VOC level");
+
+// min(x, max) without a compare-and-branch, valid for values below 2^31
+constexpr uint32_t clamp_max(uint32_t x, uint32_t max) {
+    uint32_t d = max - x;
+    uint32_t over = (uint32_t) ((int32_t) d >> 31);
+    return max - (d & ~over);
+}
+
+// linear interpolation between the two grid points around x
+template <typename T, std::size_t N>
+constexpr uint32_t interpolate(const grid_table<T, N> &t, uint32_t x) {
+    x = clamp_max(x, t.x_max());
+    uint32_t i = x >> t.shift;
+    uint32_t frac = x & ((1u << t.shift) - 1);
+    int32_t y0 = (int32_t) t.y[i];
+    int32_t y1 = (int32_t) t.y[i + 1];
+    return (uint32_t) (y0 + (((y1 - y0) * (int32_t) frac) >> t.shift));
+}
+
+static_assert(interpolate(pm25_aqi_table, 0) == 0, "AQI of clean air");
+static_assert(interpolate(pm25_aqi_table, 5000) == 500, "AQI saturates above the table");
+static_assert(interpolate(voc_table, 256) == IAQ_VOC_CLEAN_PPB, "VOC at the baseline");
+
+} // namespace aq
+
+#endif //AQ_TABLES_HPP
@@ -1,27 +1,82 @@
 #include <stdio.h>
 #include "bme680.h"
+#include "bme680_fixed.h"
 #include "hardware/gpio.h"
 #include "pico/stdlib.h"
 #include "config/config.h"
+#include "utils/reg_cache.h"
+#include "utils/flash_store.h"
+#include "hardware/flash.h"
+#include "pico/btstack_flash_bank.h"
 #include <string.h>
 #include <math.h>
 
 static struct bme68x_dev bme;
+static struct bme68x_conf conf;
 static i2c_inst_t *i2c_port;
+static i2c_dma_device_t i2c_dev;
 
-BME68X_INTF_RET_TYPE bme68x_i2c_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr) {
-    int ret = i2c_write_blocking(i2c_port, BME680_I2C_ADDR, &reg_addr, 1, true);
-    if (ret < 0) return ret;
+typedef enum {
+    BME680_IDLE,
+    BME680_MEASURING,   // forced mode running, waiting for the alarm
+    BME680_DATA_READY   // alarm fired, result to be read in thread context
+} bme680_state_t;
+
+static volatile bme680_state_t state = BME680_IDLE;
+static absolute_time_t ready_time;
+static bme680_result_cb_t result_callback;
+static void *result_user_data;
+static uint8_t poll_retries;
+
+// heater scan, one forced conversion per set-point; the measuring states are shared
+static struct bme68x_heatr_conf forced_heatr;   // single step restored after a scan
+static bool scanning;
+static bool scan_cancelled;
+static bme680_heater_profile_t scan_profile;
+static bme680_scan_t scan;
+static bme680_scan_cb_t scan_callback;
+static void *scan_user_data;
+
+static bme680_bus_stats_t bus_stats;
+static reg_cache_t reg_cache;
+static bme680_boot_stats_t boot_stats;
+static iaq_estimator_t iaq;
+
+// calibration record kept in flash. The key only tells the record apart from
+// other flash_store users and is the same for every BME680; a swapped sensor
+// is caught by bme68x_init_with_calib() reading back the variant ID and the
+// humidity, gas and heater coefficients
+typedef struct {
+    uint8_t variant_id;
+    struct bme68x_calib_data calib;
+} bme680_calib_record_t;
+
+#define BME680_CALIB_KEY    ((BME68X_CHIP_ID << 8) | BME680_I2C_ADDR)
 
-    ret = i2c_read_blocking(i2c_port, BME680_I2C_ADDR, reg_data, len, false);
+// pico_btstack_flash_bank keeps the BLE bond store at the end of flash
+_Static_assert(BME680_CALIB_FLASH_OFFSET + FLASH_SECTOR_SIZE <= PICO_FLASH_BANK_STORAGE_OFFSET,
+               "BME680 calibration sector overlaps the BTstack flash bank");
+
+BME68X_INTF_RET_TYPE bme68x_i2c_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void *intf_ptr) {
+    uint32_t start = time_us_32();
+    int ret = reg_cache_read(&reg_cache, reg_addr, reg_data, len);
+    bus_stats.bus_us += time_us_32() - start;
     return (ret < 0) ? ret : 0;
 }
 
+// the driver interleaves multi-register writes as reg_addr, data0, reg1, data1, ...
 BME68X_INTF_RET_TYPE bme68x_i2c_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void *intf_ptr) {
     uint8_t buf[len + 1];
     buf[0] = reg_addr;
     memcpy(buf + 1, reg_data, len);
-    int ret = i2c_write_blocking(i2c_port, BME680_I2C_ADDR, buf, len + 1, false);
+    uint32_t start = time_us_32();
+    int ret = reg_cache_write_pairs(&reg_cache, buf, (len + 1) / 2);
+    bus_stats.bus_us += time_us_32() - start;
+
+    // a soft reset restores every register to its default
+    if (reg_addr == BME68X_REG_SOFT_RESET) {
+        reg_cache_invalidate(&reg_cache);
+    }
     return (ret < 0) ? ret : 0;
 }
 
@@ -40,6 +95,15 @@ bool bme680_init(i2c_inst_t *i2c_inst) {
     gpio_pull_up(BME680_SDA_PIN);
     gpio_pull_up(BME680_SCL_PIN);*/
 
+    // shadow the heater (0x50-0x6E) and control (0x70-0x75) registers
+    i2c_dma_device_init(&i2c_dev, i2c_inst, BME680_I2C_ADDR, I2C_DMA_PRIO_NORMAL, BME680_I2C_TIMEOUT_US, "BME680");
+    reg_cache_init(&reg_cache, &i2c_dev, 0);
+    reg_cache_mark_cacheable(&reg_cache, BME68X_REG_IDAC_HEAT0, BME68X_REG_SHD_HEATR_DUR);
+    reg_cache_mark_cacheable(&reg_cache, BME68X_REG_CTRL_GAS_0, BME68X_REG_CTRL_HUM);
+    reg_cache_mark_cacheable(&reg_cache, BME68X_REG_CTRL_MEAS, BME68X_REG_CONFIG);
+
+    iaq_init(&iaq);
+
     //BME680 initialization
     bme.intf = BME68X_I2C_INTF;
     bme.read = bme68x_i2c_read;
@@ -48,14 +112,38 @@ bool bme680_init(i2c_inst_t *i2c_inst) {
     bme.intf_ptr = i2c_inst;
     bme.amb_temp = 25;
 
-    int8_t rslt = bme68x_init(&bme);
-    if (rslt != BME68X_OK) {
+    // a stored calibration saves reading the coefficient blocks from the sensor
+    uint32_t start = time_us_32();
+    bme680_calib_record_t record;
+    bool stored = flash_store_load(BME680_CALIB_FLASH_OFFSET, BME680_CALIB_KEY, &record, sizeof(record));
+    int8_t rslt;
+    if (stored) {
+        bme.variant_id = record.variant_id;
+        bme.calib = record.calib;
+        rslt = bme68x_init_with_calib(&bme);
+    } else {
+        rslt = bme68x_init(&bme);
+    }
+    if (rslt < BME68X_OK) {
         printf("BME68X initialization failed: %d\n", rslt);
         return false;
     }
+    boot_stats.calib_from_flash = stored && rslt == BME68X_OK;
+    boot_stats.init_us = time_us_32() - start;
+    boot_stats.init_transactions = reg_cache.stats.transactions;
+    boot_stats.save_us = 0;
+
+    if (!boot_stats.calib_from_flash) {
+        record.variant_id = bme.variant_id;
+        record.calib = bme.calib;
+        start = time_us_32();
+        if (!flash_store_save(BME680_CALIB_FLASH_OFFSET, BME680_CALIB_KEY, &record, sizeof(record))) {
+            printf("Failed to store BME680 calibration\n");
+        }
+        boot_stats.save_us = time_us_32() - start;
+    }
 
     //config sensor settings
-    struct bme68x_conf conf;
     conf.filter = BME680_FILTER_SIZE;
     conf.odr = BME68X_ODR_NONE;
     conf.os_hum = BME680_OS_HUMIDITY;
@@ -68,65 +156,253 @@ bool bme680_init(i2c_inst_t *i2c_inst) {
         return false;
     }
 
-    struct bme68x_heatr_conf heatr_conf;
-    heatr_conf.enable = BME68X_ENABLE;
-    heatr_conf.heatr_temp = 320;
-    heatr_conf.heatr_dur = BME680_HEATER_DURATION_MS;
-    rslt = bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, &bme);
+    forced_heatr.enable = BME68X_ENABLE;
+    forced_heatr.heatr_temp = 320;
+    forced_heatr.heatr_dur = BME680_HEATER_DURATION_MS;
+    rslt = bme68x_set_heatr_conf(BME68X_FORCED_MODE, &forced_heatr, &bme);
     if (rslt != BME68X_OK) {
         printf("Failed to set heater configuration: %d\n", rslt);
         return false;
     }
 
+    // per-sample statistics should not include the calibration reads
+    memset(&bus_stats, 0, sizeof(bus_stats));
+    reg_cache_reset_stats(&reg_cache);
+
     printf("BME680 initialization complete\n");
     return true;
 }
 
-bool bme680_read_data(air_quality_t *data) {
-    struct bme68x_data sensor_data;
-    uint8_t n_fields;
+static int64_t measurement_done_alarm(alarm_id_t id, void *user_data) {
+    state = BME680_DATA_READY;
+    return 0;
+}
 
+static bool trigger_forced(uint32_t heater_ms) {
     int8_t rslt = bme68x_set_op_mode(BME68X_FORCED_MODE, &bme);
     if (rslt != BME68X_OK) return false;
 
-    sleep_ms(BME680_WARMUP_TIME_MS);
+    // TPH conversion time plus the heater step
+    uint32_t dur_us = bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, &bme) + heater_ms * 1000;
 
-    rslt = bme68x_get_data(BME68X_FORCED_MODE, &sensor_data, &n_fields, &bme);
-    if (rslt != BME68X_OK) return false;
+    poll_retries = 0;
+    ready_time = make_timeout_time_us(dur_us);
+    state = BME680_MEASURING;
 
-    if (sensor_data.status & BME68X_NEW_DATA_MSK) {
-        data->temperature = sensor_data.temperature;
-        data->humidity = sensor_data.humidity;
-        data->pressure = sensor_data.pressure;
-        data->gas_resistance = sensor_data.gas_resistance / 1000.0f;  //conferts to kilo ohms
+    if (add_alarm_at(ready_time, measurement_done_alarm, NULL, true) < 0) {
+        state = BME680_IDLE;
+        return false;
+    }
+    return true;
+}
+
+bool bme680_start_measurement(bme680_result_cb_t callback, void *user_data) {
+    if (state != BME680_IDLE) return false;
+
+    result_callback = callback;
+    result_user_data = user_data;
+    return trigger_forced(BME680_HEATER_DURATION_MS);
+}
 
-        data->voc_ppm = calculate_voc_ppm(
-            data->gas_resistance,
-            data->temperature,
-            data->humidity
-        );
-        return true;
+static int8_t read_field(struct bme68x_data *field) {
+    int8_t rslt;
+
+#if BME680_FAST_FIELD_READ
+    // one 17-byte burst, heater registers come from the driver's cache
+    rslt = bme68x_get_forced_data_burst(field, &bme);
+#else
+    uint8_t n_fields;
+    rslt = bme68x_get_data(BME68X_FORCED_MODE, field, &n_fields, &bme);
+#endif
+    if (rslt != BME68X_OK) return rslt;
+
+    if (!(field->status & BME68X_NEW_DATA_MSK)) return BME68X_W_NO_NEW_DATA;
+
+    // the sensor drops back to sleep by itself after a forced conversion
+    reg_cache_update_bits(&reg_cache, BME68X_REG_CTRL_MEAS, BME68X_MODE_MSK, BME68X_SLEEP_MODE);
+    return BME68X_OK;
+}
+
+static bool field_gas_stable(const struct bme68x_data *field) {
+    return (field->status & (BME68X_GASM_VALID_MSK | BME68X_HEAT_STAB_MSK))
+           == (BME68X_GASM_VALID_MSK | BME68X_HEAT_STAB_MSK);
+}
+
+static void field_to_result(const struct bme68x_data *field, air_quality_t *data) {
+    bme680_field_to_fixed(field, &data->temperature, &data->humidity,
+                          &data->pressure, &data->gas_resistance);
+    data->gas_stable = field_gas_stable(field);
+
+    iaq_result_t iaq_result;
+    iaq_update(&iaq, data->gas_resistance, data->humidity, &iaq_result);
+    data->voc_ppb = iaq_result.voc_ppb;
+    data->iaq = iaq_result.index;
+    data->iaq_accuracy = iaq_result.accuracy;
+}
+
+// nb_conv picks the res_heat_x / gas_wait_x set-point of the next forced conversion
+static bool start_scan_step(void) {
+    uint8_t reg = BME68X_REG_CTRL_GAS_1;
+    uint8_t ctrl_gas_1;
+    if (bme68x_get_regs(reg, &ctrl_gas_1, 1, &bme) != BME68X_OK) return false;
+    ctrl_gas_1 = BME68X_SET_BITS_POS_0(ctrl_gas_1, BME68X_NBCONV, scan.steps);
+    if (bme68x_set_regs(&reg, &ctrl_gas_1, 1, &bme) != BME68X_OK) return false;
+
+    return trigger_forced(scan_profile.dur_ms[scan.steps]);
+}
+
+// the single forced step also resets nb_conv to set-point 0
+static void end_scan(bool ok) {
+    scanning = false;
+    if (bme68x_set_heatr_conf(BME68X_FORCED_MODE, &forced_heatr, &bme) != BME68X_OK) {
+        printf("Failed to restore the heater configuration\n");
+    }
+    if (scan_callback != NULL) {
+        scan_callback(ok, &scan, scan_user_data);
     }
+}
 
-    return false;
+// the gas reading is filed under the set-point the sensor reports having used
+static void scan_step_done(bool ok, const struct bme68x_data *field) {
+    if (ok && !scan_cancelled && field->gas_index == scan.steps) {
+        int16_t temperature;
+        uint32_t humidity, pressure;
+        bme680_field_to_fixed(field, &temperature, &humidity, &pressure, &scan.gas_resistance[scan.steps]);
+        if (field_gas_stable(field)) {
+            scan.stable_mask |= (uint16_t) (1u << scan.steps);
+        }
+        scan.steps++;
+        if (scan.steps == scan_profile.steps) {
+            end_scan(true);
+            return;
+        }
+        if (start_scan_step()) {
+            return;
+        }
+    }
+    end_scan(false);
 }
 
-float calculate_voc_ppm(float gas_resistance, float temperature, float humidity) {
-    float resistance_k = gas_resistance;
+bool bme680_start_scan(const bme680_heater_profile_t *profile, bme680_scan_cb_t callback, void *user_data) {
+    if (state != BME680_IDLE || profile->steps == 0 || profile->steps > BME680_SCAN_MAX_STEPS) return false;
+
+    scan_profile = *profile;
+    memset(&scan, 0, sizeof(scan));
 
-    if (resistance_k >= 50.0f) {
-        return 0.0f;
+    // the driver's sequential-mode path programs every set-point in one go;
+    // the BME680 has no sequential mode, it stays in forced mode and nb_conv
+    // selects the step
+    struct bme68x_heatr_conf heatr = {0};
+    heatr.enable = BME68X_ENABLE;
+    heatr.heatr_temp_prof = scan_profile.temp_c;
+    heatr.heatr_dur_prof = scan_profile.dur_ms;
+    heatr.profile_len = scan_profile.steps;
+    if (bme68x_set_heatr_conf(BME68X_SEQUENTIAL_MODE, &heatr, &bme) != BME68X_OK) {
+        bme68x_set_heatr_conf(BME68X_FORCED_MODE, &forced_heatr, &bme);
+        return false;
     }
-    else if (resistance_k >= 10.0f) {
-        return (50.0f - resistance_k) * (1.0f / 40.0f);
+
+    scan_callback = callback;
+    scan_user_data = user_data;
+    scanning = true;
+    scan_cancelled = false;
+    if (!start_scan_step()) {
+        scan_callback = NULL;
+        end_scan(false);
+        return false;
     }
-    else if (resistance_k >= 5.0f) {
-        return 1.0f + (10.0f - resistance_k) * (5.0f / 5.0f);
+    return true;
+}
+
+void bme680_cancel_scan(void) {
+    scan_cancelled = scanning;
+}
+
+void bme680_poll(void) {
+    if (state != BME680_DATA_READY) return;
+
+    struct bme68x_data field;
+    int8_t rslt = read_field(&field);
+
+    // conversion not finished yet, check again shortly instead of blocking
+    if (rslt == BME68X_W_NO_NEW_DATA && poll_retries < BME680_POLL_MAX_RETRIES) {
+        poll_retries++;
+        bus_stats.poll_retries++;
+        ready_time = make_timeout_time_us(BME680_POLL_RETRY_US);
+        state = BME680_MEASURING;
+        if (add_alarm_at(ready_time, measurement_done_alarm, NULL, true) >= 0) {
+            return;
+        }
+    }
+
+    state = BME680_IDLE;
+    bus_stats.samples++;
+
+    if (scanning) {
+        scan_step_done(rslt == BME68X_OK, &field);
+        return;
+    }
+
+    air_quality_t result;
+    if (rslt == BME68X_OK) {
+        field_to_result(&field, &result);
+    }
+    if (result_callback != NULL) {
+        result_callback(rslt == BME68X_OK, &result, result_user_data);
+    }
+}
+
+bool bme680_busy(void) {
+    return state != BME680_IDLE;
+}
+
+absolute_time_t bme680_ready_time(void) {
+    return ready_time;
+}
+
+void bme680_get_bus_stats(bme680_bus_stats_t *stats) {
+    *stats = bus_stats;
+    stats->transactions = reg_cache.stats.transactions;
+}
+
+void bme680_get_reg_cache_stats(reg_cache_stats_t *stats) {
+    reg_cache_get_stats(&reg_cache, stats);
+}
+
+void bme680_get_boot_stats(bme680_boot_stats_t *stats) {
+    *stats = boot_stats;
+}
+
+typedef struct {
+    bool ok;
+    air_quality_t *data;
+} blocking_result_t;
+
+static void copy_result(bool ok, const air_quality_t *result, void *user_data) {
+    blocking_result_t *blocking = (blocking_result_t *) user_data;
+    blocking->ok = ok;
+    if (ok) {
+        *blocking->data = *result;
     }
-    else if (resistance_k >= 2.0f) {
-        return 6.0f + (5.0f - resistance_k) * (4.0f / 3.0f);
+}
+
+static void wait_for_measurement(void) {
+    while (bme680_busy()) {
+        sleep_until(ready_time);
+        bme680_poll();
     }
-    else {
-        return 10.0f + (2.0f - resistance_k) * (40.0f / 2.0f);
+}
+
+bool bme680_read_data(air_quality_t *data) {
+    blocking_result_t blocking = { false, data };
+
+    // let a measurement started through the asynchronous API finish first
+    if (bme680_busy()) {
+        wait_for_measurement();
     }
-}
\ No newline at end of file
+
+    if (!bme680_start_measurement(copy_result, &blocking)) return false;
+    wait_for_measurement();
+
+    return blocking.ok;
+}
@@ -3,6 +3,8 @@
 
 #include "hardware/i2c.h"
 #include "sensorutils/bme68x/bme68x.h"
+#include "utils/reg_cache.h"
+#include "iaq.h"
 #include <stdbool.h>
 
 #define BME680_I2C_ADDR         0x77
@@ -14,18 +16,87 @@
 #define BME680_OS_TEMPERATURE      BME68X_OS_2X          //temperature oversampling
 #define BME680_FILTER_SIZE         BME68X_FILTER_SIZE_3  //IIR filter size
 
+// fixed-point in both compensation builds, the RP2040 has no FPU
 typedef struct {
-    float temperature;
-    float humidity;
-    float pressure;
-    float gas_resistance;
-    float voc_ppm;
+    int16_t temperature;        //degrees C x100
+    uint32_t humidity;          //% relative humidity x1000
+    uint32_t pressure;          //Pa
+    uint32_t gas_resistance;    //ohms
+    uint32_t voc_ppb;           //VOC estimate in ppb, relative to the clean-air baseline
+    uint16_t iaq;               //air quality index, 0 (excellent) to 500
+    uint8_t iaq_accuracy;       //iaq_accuracy_t, 0 while the baseline is burning in
+    bool gas_stable;            //heater reached its target and the gas reading is valid
 } air_quality_t;
 
 
-float calculate_voc_ppm(float gas_resistance, float temperature, float humidity);
+typedef struct {
+    uint32_t samples;       // completed forced-mode measurements
+    uint32_t transactions;  // I2C transactions, a register read is one write+read transfer
+    uint32_t bus_us;        // time spent inside blocking I2C calls
+    uint32_t poll_retries;  // result reads that found the conversion still running
+} bme680_bus_stats_t;
+
+typedef struct {
+    bool calib_from_flash;      // stored calibration was valid for the attached sensor
+    uint32_t init_us;           // bme68x initialisation time, excluding the flash write
+    uint32_t init_transactions; // I2C transactions during bme68x initialisation
+    uint32_t save_us;           // time spent storing calibration, 0 if not needed
+} bme680_boot_stats_t;
+
+#define BME680_SCAN_MAX_STEPS   10  //res_heat_0..9 / gas_wait_0..9
+
+// heater set-points, programmed into res_heat_x / gas_wait_x
+typedef struct {
+    uint8_t steps;
+    uint16_t temp_c[BME680_SCAN_MAX_STEPS];     //target temperature, degrees C
+    uint16_t dur_ms[BME680_SCAN_MAX_STEPS];     //heating time before the gas conversion
+} bme680_heater_profile_t;
+
+// gas resistance per heater step, one forced conversion each
+typedef struct {
+    uint8_t steps;                                      //completed steps
+    uint16_t stable_mask;                               //bit i: step i reached its temperature with a valid reading
+    uint32_t gas_resistance[BME680_SCAN_MAX_STEPS];     //ohms
+} bme680_scan_t;
+
+// called from bme680_poll() once an asynchronous measurement has finished
+typedef void (*bme680_result_cb_t)(bool ok, const air_quality_t *data, void *user_data);
+
+// called from bme680_poll() after the last step of a heater scan, or the step that failed
+typedef void (*bme680_scan_cb_t)(bool ok, const bme680_scan_t *scan, void *user_data);
 
 bool bme680_init(i2c_inst_t *i2c_inst);
+
+// blocking wrapper around the asynchronous API
 bool bme680_read_data(air_quality_t *data);
 
+// triggers a forced-mode measurement and arms an alarm for when it completes,
+// returns false if a measurement is already running or the trigger failed
+bool bme680_start_measurement(bme680_result_cb_t callback, void *user_data);
+
+// one forced conversion per set-point of profile, stepping nb_conv through
+// res_heat_x / gas_wait_x; the single forced-mode step is restored at the end.
+// Returns false if a measurement or scan is already running.
+bool bme680_start_scan(const bme680_heater_profile_t *profile, bme680_scan_cb_t callback, void *user_data);
+
+// the step under way still completes, the next bme680_poll() then ends the
+// scan with ok false instead of starting another
+void bme680_cancel_scan(void);
+
+// call from thread context; reads and delivers the result once the alarm fired
+void bme680_poll(void);
+
+bool bme680_busy(void);
+
+// time at which the running measurement (heater included) completes
+absolute_time_t bme680_ready_time(void);
+
+void bme680_get_bus_stats(bme680_bus_stats_t *stats);
+
+// hit/miss counters of the configuration register shadow
+void bme680_get_reg_cache_stats(reg_cache_stats_t *stats);
+
+// cost of the last bme680_init, to compare warm boots against cold ones
+void bme680_get_boot_stats(bme680_boot_stats_t *stats);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef BME680_FIXED_H
+#define BME680_FIXED_H
+
+#include <stdint.h>
+#include "sensorutils/bme68x/bme68x.h"
+
+// the integer build already reports x100 / x1000 fixed point, the FPU build
+// reports plain units and is scaled once here; inline so the host tests can
+// run it against both builds of the driver
+static inline void bme680_field_to_fixed(const struct bme68x_data *field, int16_t *temperature,
+                                         uint32_t *humidity, uint32_t *pressure, uint32_t *gas_resistance) {
+#ifdef BME68X_USE_FPU
+    *temperature = (int16_t) (field->temperature * 100.0f);
+    *humidity = (uint32_t) (field->humidity * 1000.0f);
+    *pressure = (uint32_t) field->pressure;
+    *gas_resistance = (uint32_t) field->gas_resistance;
+#else
+    *temperature = field->temperature;
+    *humidity = field->humidity;
+    *pressure = field->pressure;
+    *gas_resistance = field->gas_resistance;
+#endif
+}
+
+#endif //BME680_FIXED_H
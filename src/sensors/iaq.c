@@ -0,0 +1,107 @@
+#include "iaq.h"
+#include "aq_tables.h"
+#include <string.h>
+
+#define IAQ_GAS_MAX         0x0FFFFFFFu     //keeps the x16 baseline inside 32 bits
+
+void iaq_init(iaq_estimator_t *iaq) {
+    memset(iaq, 0, sizeof(*iaq));
+    iaq->accuracy = IAQ_ACCURACY_UNRELIABLE;
+}
+
+// wet air lowers the resistance, scale the reading back to the reference humidity
+static uint32_t compensate_humidity(uint32_t gas, uint32_t humidity) {
+    int32_t factor = 65536 + (int32_t) (((int64_t) ((int32_t) humidity - IAQ_HUM_REF) * IAQ_HUM_COMP_Q16_PER_PCT) / 1000);
+    if (factor < 32768) factor = 32768;
+    if (factor > 131072) factor = 131072;
+
+    uint64_t comp = ((uint64_t) gas * (uint32_t) factor) >> 16;
+    return comp > IAQ_GAS_MAX ? IAQ_GAS_MAX : (uint32_t) comp;
+}
+
+static void update_baseline(iaq_estimator_t *iaq, uint32_t gas_q4) {
+    if (iaq->samples == 0) {
+        iaq->baseline_q4 = gas_q4;
+    } else if (iaq->samples < IAQ_BURN_IN_SAMPLES) {
+        // heater still settling, follow the reading in both directions
+        if (gas_q4 > iaq->baseline_q4) {
+            iaq->baseline_q4 += (gas_q4 - iaq->baseline_q4) >> 3;
+        } else {
+            iaq->baseline_q4 -= (iaq->baseline_q4 - gas_q4) >> 3;
+        }
+    } else if (gas_q4 > iaq->baseline_q4) {
+        // higher resistance means cleaner air than the current baseline
+        iaq->baseline_q4 += (gas_q4 - iaq->baseline_q4) >> 4;
+    } else {
+        // only drift down slowly so pollution events are not learned as clean air
+        iaq->baseline_q4 -= (iaq->baseline_q4 - gas_q4) >> 12;
+    }
+}
+
+static void update_accuracy(iaq_estimator_t *iaq, uint32_t gas_q4) {
+    uint32_t diff = gas_q4 > iaq->baseline_q4 ? gas_q4 - iaq->baseline_q4 : iaq->baseline_q4 - gas_q4;
+    uint64_t dev_q8 = ((uint64_t) diff << 8) / (iaq->baseline_q4 ? iaq->baseline_q4 : 1);
+    if (dev_q8 > 4 * 256) dev_q8 = 4 * 256;
+
+    if (dev_q8 > iaq->spread_q8) {
+        iaq->spread_q8 += ((uint32_t) dev_q8 - iaq->spread_q8) >> 4;
+    } else {
+        iaq->spread_q8 -= (iaq->spread_q8 - (uint32_t) dev_q8) >> 4;
+    }
+
+    if (iaq->samples < IAQ_BURN_IN_SAMPLES) {
+        iaq->accuracy = IAQ_ACCURACY_UNRELIABLE;
+        return;
+    }
+
+    if (iaq->spread_q8 < IAQ_STABLE_SPREAD_Q8) {
+        iaq->stable_run++;
+    } else {
+        iaq->stable_run = 0;
+    }
+
+    uint32_t steps = iaq->stable_run / IAQ_STABLE_SAMPLES;
+    iaq->accuracy = steps >= 2 ? IAQ_ACCURACY_HIGH : (iaq_accuracy_t) (IAQ_ACCURACY_LOW + steps);
+}
+
+// 0..1000, higher is better, sharing IAQ_GAS_WEIGHT between gas and humidity
+static uint32_t quality_score(uint32_t gas, uint32_t baseline, uint32_t humidity) {
+    uint32_t gas_score = IAQ_GAS_WEIGHT * 10;
+    if (gas < baseline) {
+        gas_score = (uint32_t) (((uint64_t) gas * IAQ_GAS_WEIGHT * 10) / baseline);
+    }
+
+    uint32_t hum_weight = (100 - IAQ_GAS_WEIGHT) * 10;
+    if (humidity > 100000) humidity = 100000;
+    uint32_t hum_score;
+    if (humidity <= IAQ_HUM_REF) {
+        hum_score = hum_weight * humidity / IAQ_HUM_REF;
+    } else {
+        hum_score = hum_weight * (100000 - humidity) / (100000 - IAQ_HUM_REF);
+    }
+    return gas_score + hum_score;
+}
+
+// the power-law curve itself lives in the compile-time table of aq_tables.hpp
+static uint32_t estimate_voc(uint32_t gas, uint32_t baseline) {
+    uint64_t ratio_q8 = ((uint64_t) baseline << 8) / (gas ? gas : 1);
+    if (ratio_q8 > IAQ_RATIO_MAX_Q8) ratio_q8 = IAQ_RATIO_MAX_Q8;
+    return aq_voc_ppb((uint32_t) ratio_q8);
+}
+
+void iaq_update(iaq_estimator_t *iaq, uint32_t gas_resistance, uint32_t humidity, iaq_result_t *result) {
+    uint32_t comp = compensate_humidity(gas_resistance, humidity);
+    uint32_t gas_q4 = comp << 4;
+
+    update_baseline(iaq, gas_q4);
+    update_accuracy(iaq, gas_q4);
+    iaq->samples++;
+
+    uint32_t baseline = iaq->baseline_q4 >> 4;
+    if (baseline == 0) baseline = 1;
+
+    result->index = (uint16_t) ((1000 - quality_score(comp, baseline, humidity)) / 2);
+    result->voc_ppb = estimate_voc(comp, baseline);
+    result->gas_compensated = comp;
+    result->accuracy = iaq->accuracy;
+}
@@ -0,0 +1,48 @@
+#ifndef IAQ_H
+#define IAQ_H
+
+#include <stdint.h>
+
+// Incremental indoor air quality estimate from BME680 gas resistance.
+// Tracks a clean-air baseline that follows rising resistance quickly and
+// falling resistance slowly, compensates the gas reading for humidity and
+// combines both into an index. Fixed size state, O(1) integer math per sample.
+
+#define IAQ_BURN_IN_SAMPLES         50      //samples before the baseline is trusted
+#define IAQ_STABLE_SAMPLES          100     //consecutive stable samples per accuracy step
+#define IAQ_STABLE_SPREAD_Q8        26      //mean |gas - baseline| / baseline below ~10% counts as stable
+#define IAQ_HUM_REF                 40000   //% relative humidity x1000 considered ideal
+#define IAQ_HUM_COMP_Q16_PER_PCT    1638    //gas resistance drops ~2.5% per %RH above the reference
+#define IAQ_GAS_WEIGHT              75      //share of the air quality score from gas, rest is humidity
+#define IAQ_VOC_CLEAN_PPB           250     //VOC estimate when the reading equals the baseline
+#define IAQ_VOC_MAX_PPB             50000
+#define IAQ_RATIO_MAX_Q8            (16 * 256)  //baseline / gas ratios above 16 are clamped
+
+typedef enum {
+    IAQ_ACCURACY_UNRELIABLE,    // burn-in, baseline not established
+    IAQ_ACCURACY_LOW,           // baseline set, still moving
+    IAQ_ACCURACY_MEDIUM,
+    IAQ_ACCURACY_HIGH
+} iaq_accuracy_t;
+
+typedef struct {
+    uint32_t baseline_q4;       // clean-air gas resistance, ohms x16
+    uint32_t spread_q8;         // running mean of |gas - baseline| / baseline
+    uint32_t samples;
+    uint32_t stable_run;        // consecutive samples with a small spread
+    iaq_accuracy_t accuracy;
+} iaq_estimator_t;
+
+typedef struct {
+    uint16_t index;             // 0 (excellent) to 500 (extremely polluted)
+    uint32_t voc_ppb;           // VOC estimate from the drop below the baseline
+    uint32_t gas_compensated;   // humidity compensated gas resistance, ohms
+    iaq_accuracy_t accuracy;
+} iaq_result_t;
+
+void iaq_init(iaq_estimator_t *iaq);
+
+// gas_resistance in ohms, humidity in % relative humidity x1000
+void iaq_update(iaq_estimator_t *iaq, uint32_t gas_resistance, uint32_t humidity, iaq_result_t *result);
+
+#endif //IAQ_H
@@ -1,27 +1,77 @@
 #include <stdio.h>
-#include <math.h>
 #include "pico/stdlib.h"
 #include "pico/binary_info.h"
 #include "hardware/i2c.h"
-#include "config/pin_config.h"
+#include "config/config.h"
 #include "lis3.h"
+#include "utils/reg_cache.h"
 
-const float NO_MOVEMENT_THRESH = 0.10f;
-const uint32_t NO_MOVEMENT_DURATION_MS = 100000000;  // 10000 s in milliseconds// 1-second check interval
-static uint32_t no_movement_start_time;
-static bool no_movement_timer_running = false;
 //const float ACCEL_GRAV = 9.81f;
 
 static i2c_inst_t *i2c_port;
+static i2c_dma_device_t i2c_dev;
+static reg_cache_t reg_cache;
+static uint8_t ctrl_reg3 = 0;
+static bool movement_detection = false;  // IA1 wanted on INT1 whenever the FIFO is off
+static uint32_t odr_hz = 0;
+static uint32_t act_duration_ms = 0;    // 0 while activity detection is off
+
+// ODR / power mode per governor state
+typedef struct {
+	uint8_t ctrl_reg1;
+	uint32_t odr_hz;
+} lis3_rate_t;
+
+static const lis3_rate_t lis3_rates[LIS3_RATE_COUNT] = {
+	[LIS3_RATE_SLEEP]    = {0x2F, 10},   // 10 Hz low power
+	[LIS3_RATE_IDLE]     = {0x3F, 25},   // 25 Hz low power
+	[LIS3_RATE_CLASSIFY] = {0x57, 100},  // 100 Hz normal mode
+};
+
+static lis3_rate_state_t rate_state = LIS3_RATE_COUNT;  // not under governor control yet
+static uint32_t rate_state_since_ms;
+static uint32_t classify_until_ms;
+static lis3_governor_stats_t governor_stats;
+
+static bool fifo_enabled = false;
+static volatile bool fifo_ready = false;
+static lis3_fifo_callback_t fifo_callback;
+static void *fifo_user_data;
+
+// convert to meaningful acceleration values
+#define LIS3_SENSITIVITY 0.004f                 // g per unit
+#define LIS3_SCALING (64 / LIS3_SENSITIVITY)    // 10-bit data is left-justified in 16 bits
+
+static int lis3_write_reg(uint8_t reg, uint8_t value) {
+	return reg_cache_write(&reg_cache, reg, &value, 1);
+}
+
+// reads len consecutive registers starting at reg
+static bool lis3_read_regs(uint8_t reg, uint8_t *dst, size_t len) {
+	return reg_cache_read(&reg_cache, reg, dst, len) == (int) len;
+}
 
 // operation modes:
 // 0 - low power mode (1 ms turn on time)
 // 1 - normal mode (1.6 ms turn on time)
-// (unused) 2 - high resolution mode (7/ODR ms turn on time)
+// 2 - normal mode at 100 Hz, slow enough for ACT_DUR to cover ~20 s
+// (unused) high resolution mode (7/ODR ms turn on time)
 //void LIS3_init(i2c_inst_t *i2c_inst, int operation_mode)
 void LIS3_init(i2c_inst_t *i2c_inst, int operation_mode) {
 	printf("Starting LIS3DH initialization...\n");
 	i2c_port = i2c_inst;
+	rate_state = LIS3_RATE_COUNT;  // fixed operation mode until the governor takes over
+
+	// configuration registers are shadowed, output and status registers always hit the bus
+	// motion reads go ahead of queued BME680 traffic on the shared bus
+	i2c_dma_device_init(&i2c_dev, i2c_inst, LIS3_I2C_ADDR, I2C_DMA_PRIO_HIGH, LIS3_I2C_TIMEOUT_US, "LIS3DH");
+	reg_cache_init(&reg_cache, &i2c_dev, LIS3_AUTO_INCREMENT);
+	reg_cache_mark_cacheable(&reg_cache, 0x1E, CTRL_REG6);
+	reg_cache_mark_cacheable(&reg_cache, FIFO_CTRL_REG, FIFO_CTRL_REG);
+	reg_cache_mark_cacheable(&reg_cache, INT1_CFG, INT1_CFG);
+	reg_cache_mark_cacheable(&reg_cache, INT1_THS, 0x34);     // INT1_THS, INT1_DURATION, INT2_CFG
+	reg_cache_mark_cacheable(&reg_cache, INT2_THS, 0x38);     // INT2_THS, INT2_DURATION, CLICK_CFG
+	reg_cache_mark_cacheable(&reg_cache, 0x3A, ACT_DUR);      // click and activity settings
 
 	// i2c initialization
 	//i2c_init(i2c_port, LIS3_I2C_FREQ);
@@ -32,24 +82,24 @@ void LIS3_init(i2c_inst_t *i2c_inst, int operation_mode) {
 	// make the I2C pins available to picotool
 	//bi_decl(bi_2pins_with_func(LIS3_SDA_PIN, LIS3_SCL_PIN, GPIO_FUNC_I2C));
 
-	uint8_t buf[2];
 	// turn low power mode and 400 Hz on
 	if (operation_mode == 0) {
-		buf[0] = CTRL_REG1;
-		buf[1] = 0x7F;
-		i2c_write_blocking(i2c_port, LIS3_I2C_ADDR, buf, 2, false);
+		lis3_write_reg(CTRL_REG1, 0x7F);
+		odr_hz = 400;
 
 		// turn normal mode and 1.314 kHz on
 	} else if (operation_mode == 1) {
-		buf[0] = CTRL_REG1;
-		buf[1] = 0x97;
-		i2c_write_blocking(i2c_port, LIS3_I2C_ADDR, buf, 2, false);
+		lis3_write_reg(CTRL_REG1, 0x97);
+		odr_hz = 1344;
+
+		// turn normal mode and 100 Hz on
+	} else if (operation_mode == 2) {
+		lis3_write_reg(CTRL_REG1, 0x57);
+		odr_hz = 100;
 	}
 
 	// high pass filter initialize - filters out gravity consideration
-	buf[0] = CTRL_REG2;
-	buf[1] = 0x09;
-	i2c_write_blocking(i2c_port, LIS3_I2C_ADDR, buf, 2, false);
+	lis3_write_reg(CTRL_REG2, 0x09);
 
 	// latching interrupt
 	//buf[0] = CTRL_REG5;
@@ -58,44 +108,36 @@ void LIS3_init(i2c_inst_t *i2c_inst, int operation_mode) {
 
 	// set up interrupt configs
 	// set interrupt threshold to 250 mg
-	buf[0] = INT1_THS;
-	buf[1] = 0x10;
-	i2c_write_blocking(i2c_port, LIS3_I2C_ADDR, buf, 2, false);
+	lis3_write_reg(INT1_THS, 0x10);
 
 	// default INT1_DURATION set to 0
 	// set interrupt to generate when either X, Y or Z axis is high
-	buf[0] = INT1_CFG;
-	buf[1] = 0x2A;
-	i2c_write_blocking(i2c_port, LIS3_I2C_ADDR, buf, 2, false);
+	lis3_write_reg(INT1_CFG, 0x2A);
 
 	enable_movement_detection();
 }
 
 // sleep to wake interrupt setup
 void enable_movement_detection() {
-	uint8_t buf[2];
-
 	// interrupt initialization
-	// interrupt activity 1 driven to INT1 pad
-	buf[0] = CTRL_REG3;
-	buf[1] = 0x40;
-	i2c_write_blocking(i2c_port, LIS3_I2C_ADDR, buf, 2, false);
+	// interrupt activity 1 driven to INT1 pad, once the FIFO releases it
+	movement_detection = true;
+	if (!fifo_enabled) {
+		ctrl_reg3 |= LIS3_I1_IA1;
+		lis3_write_reg(CTRL_REG3, ctrl_reg3);
+	}
 }
 
 void disable_movement_detection() { // disable interrupt
-	uint8_t buf[2];
-
 	// disable interrupt
-	buf[0] = CTRL_REG3;
-	buf[1] = 0x0;
-	i2c_write_blocking(i2c_port, LIS3_I2C_ADDR, buf, 2, false);
+	movement_detection = false;
+	ctrl_reg3 &= ~LIS3_I1_IA1;
+	lis3_write_reg(CTRL_REG3, ctrl_reg3);
 }
 
 void LIS3_clear_interrupt() {
-	uint8_t int1_src = INT1_SRC;
 	uint8_t temp;
-	i2c_write_blocking(i2c_default, LIS3_I2C_ADDR, &int1_src, 1, true);
-	i2c_read_blocking(i2c_default, LIS3_I2C_ADDR, &temp, 1, false);
+	lis3_read_regs(INT1_SRC, &temp, 1);
 }
 
 // reg is address of lsb
@@ -103,71 +145,224 @@ float LIS3_read_axis(uint8_t reg_l, uint8_t reg_h) {
 	// read two bytes of data and store in a 16 bit data structure
 	uint8_t lsb;
 	uint8_t msb;
-	i2c_write_blocking(i2c_default, LIS3_I2C_ADDR, &reg_l, 1, true);
-	i2c_read_blocking(i2c_default, LIS3_I2C_ADDR, &lsb, 1, false);
-
-	i2c_write_blocking(i2c_default, LIS3_I2C_ADDR, &reg_h, 1, true);
-	i2c_read_blocking(i2c_default, LIS3_I2C_ADDR, &msb, 1, false);
+	lis3_read_regs(reg_l, &lsb, 1);
+	lis3_read_regs(reg_h, &msb, 1);
 
 	uint16_t raw_val = (msb << 8) | lsb;
 
-	//convert to meaningful acceleration values
-	float sensitivity = 0.004f; // g per unit
-	float scaling = 64 / sensitivity;
-
 	//printf("HEX %x\n", raw_val);
 	//printf("UNSIGNED %u\n", raw_val);
 	//printf("SIGNED %i\n", (int16_t)raw_val);
 	//printf("SCALED %f\n", (float) ((int16_t) raw_val) / scaling);
 
-	return (float) ((int16_t) raw_val) / scaling;
+	return (float) ((int16_t) raw_val) / LIS3_SCALING;
+}
+
+static void lis3_unpack_sample(const uint8_t *buf, lis3_raw_t *raw) {
+	raw->x = (int16_t) ((buf[1] << 8) | buf[0]);
+	raw->y = (int16_t) ((buf[3] << 8) | buf[2]);
+	raw->z = (int16_t) ((buf[5] << 8) | buf[4]);
+}
+
+// one write of the start address followed by one 6-byte read, instead of
+// 12 single-byte transactions through LIS3_read_axis
+bool LIS3_read_raw(lis3_raw_t *raw) {
+	uint8_t buf[6];
+
+	if (!lis3_read_regs(OUT_X_L, buf, 6)) {
+		return false;
+	}
+
+	lis3_unpack_sample(buf, raw);
+	return true;
+}
+
+lis3_data_t LIS3_raw_to_g(const lis3_raw_t *raw) {
+	lis3_data_t data;
+	data.x = (float) raw->x / LIS3_SCALING;
+	data.y = (float) raw->y / LIS3_SCALING;
+	data.z = (float) raw->z / LIS3_SCALING;
+	return data;
 }
 
 lis3_data_t LIS3_read_data() { // filtering out acceleration due to gravity so check that magnitude is close to 0
-  	lis3_data_t data;
-	data.x = LIS3_read_axis(OUT_X_L, OUT_X_H);
-    data.y = LIS3_read_axis(OUT_Y_L, OUT_Y_H);
-    data.z = LIS3_read_axis(OUT_Z_L, OUT_Z_H);
-    return data;
+	lis3_raw_t raw = {0, 0, 0};
+	LIS3_read_raw(&raw);
+	return LIS3_raw_to_g(&raw);
+}
+
+uint32_t LIS3_get_bus_transactions() {
+	return reg_cache.stats.transactions;
+}
+
+void LIS3_reset_bus_transactions() {
+	reg_cache_reset_stats(&reg_cache);
+}
+
+void LIS3_get_reg_cache_stats(reg_cache_stats_t *stats) {
+	reg_cache_get_stats(&reg_cache, stats);
+}
+
+bool LIS3_fifo_enable(uint8_t watermark, lis3_fifo_callback_t callback, void *user_data) {
+	if (watermark == 0 || watermark > LIS3_FIFO_FTH_MASK || callback == NULL) {
+		return false;
+	}
+
+	fifo_callback = callback;
+	fifo_user_data = user_data;
+	fifo_ready = false;
+
+	// reset through bypass mode to discard stale samples
+	lis3_write_reg(FIFO_CTRL_REG, LIS3_FIFO_MODE_BYPASS);
+	lis3_write_reg(CTRL_REG5, LIS3_FIFO_EN);
+	// stream mode, watermark routed to INT1 (TR = 0)
+	lis3_write_reg(FIFO_CTRL_REG, LIS3_FIFO_MODE_STREAM | (watermark & LIS3_FIFO_FTH_MASK));
+
+	// the LIS3DH can only route the watermark to INT1, so it takes the pin
+	// over from the IA1 wake-up while the FIFO runs
+	ctrl_reg3 = (ctrl_reg3 & ~LIS3_I1_IA1) | LIS3_I1_WTM;
+	lis3_write_reg(CTRL_REG3, ctrl_reg3);
+
+	fifo_enabled = true;
+	return true;
 }
 
-// perform vector difference to determine movement
-bool LIS3_is_moving() {
-	lis3_data_t curr_data = LIS3_read_data();
+void LIS3_fifo_disable() {
+	ctrl_reg3 &= ~LIS3_I1_WTM;
+	if (movement_detection) {
+		ctrl_reg3 |= LIS3_I1_IA1;
+	}
+	lis3_write_reg(CTRL_REG3, ctrl_reg3);
+	lis3_write_reg(FIFO_CTRL_REG, LIS3_FIFO_MODE_BYPASS);
+	lis3_write_reg(CTRL_REG5, 0x00);
+
+	fifo_enabled = false;
+	fifo_ready = false;
+}
+
+void LIS3_fifo_notify() {
+	if (fifo_enabled) {
+		fifo_ready = true;
+	}
+}
+
+bool LIS3_fifo_pending() {
+	return fifo_ready;
+}
+
+int LIS3_fifo_drain() {
+	if (!fifo_enabled) {
+		return -1;
+	}
+	fifo_ready = false;
+
+	uint8_t src;
+	if (!lis3_read_regs(FIFO_SRC_REG, &src, 1)) {
+		return -1;
+	}
+
+	// FSS counts unread samples up to 31, overrun means all 32 slots are full
+	uint8_t count = src & LIS3_FIFO_SRC_FSS_MASK;
+	if (src & LIS3_FIFO_SRC_OVRN) {
+		count = LIS3_FIFO_DEPTH;
+	}
+	if (count == 0) {
+		return 0;
+	}
+
+	// with the FIFO enabled the auto-increment address wraps from OUT_Z_H
+	// back to OUT_X_L, so the whole batch comes out in one transfer; the
+	// bytes are not registers OUT_X_L + i and must stay out of the cache
+	uint8_t buf[LIS3_FIFO_DEPTH * 6];
+	if (reg_cache_read_stream(&reg_cache, OUT_X_L, buf, count * 6) != count * 6) {
+		return -1;
+	}
+
+	lis3_raw_t samples[LIS3_FIFO_DEPTH];
+	for (uint8_t i = 0; i < count; i++) {
+		lis3_unpack_sample(&buf[i * 6], &samples[i]);
+	}
 
-    double magnitude = sqrt(pow(curr_data.x, 2) + pow(curr_data.y, 2) + pow(curr_data.z, 2));
-	if (magnitude > NO_MOVEMENT_THRESH) {
-		return true;
+	fifo_callback(samples, count, fifo_user_data);
+	return count;
+}
+
+// inactivity time is (8 * ACT_DUR + 1) / ODR, clamp to what the register can hold
+static void lis3_write_act_dur() {
+	uint32_t dur = (act_duration_ms * odr_hz / 1000) / 8;
+	if (dur > 0xFF) {
+		dur = 0xFF;
+		printf("LIS3 inactivity duration clamped to %lu ms at %lu Hz\n",
+			   (8 * dur + 1) * 1000 / odr_hz, odr_hz);
+	}
+	lis3_write_reg(ACT_DUR, (uint8_t) dur);
+}
+
+void LIS3_enable_activity_detection(uint16_t threshold_mg, uint32_t duration_ms) {
+	uint32_t ths = threshold_mg / LIS3_ACT_THS_MG;
+	if (ths == 0) {
+		ths = 1;
+	} else if (ths > 0x7F) {
+		ths = 0x7F;
 	}
-    return false;
+
+	act_duration_ms = duration_ms;
+	lis3_write_reg(ACT_THS, (uint8_t) ths);
+	lis3_write_act_dur();
+	lis3_write_reg(CTRL_REG6, LIS3_I2_ACT);
 }
 
-// Non-blocking function to check for no movement over a 10-minute period
-bool check_no_movement_for_duration() {
+void LIS3_disable_activity_detection() {
+	lis3_write_reg(CTRL_REG6, 0x00);
+	lis3_write_reg(ACT_THS, 0x00);
+	act_duration_ms = 0;
+}
 
-	// Check if there's movement
-	if (LIS3_is_moving()) {
-		printf("Movement detected, resetting timer.\n");
-		no_movement_timer_running = false;  // stop timer
-		return false;  // return false as movement was detected
+void LIS3_set_rate_state(lis3_rate_state_t state) {
+	if (state >= LIS3_RATE_COUNT || state == rate_state) {
+		return;
 	}
 
-	//printf("No movement detected.\n");
-	if (!no_movement_timer_running) {
-		no_movement_start_time = to_ms_since_boot(get_absolute_time()); // gets number of ms since boot
-		no_movement_timer_running = true;
-		return false; // timer just started running
+	uint32_t now = to_ms_since_boot(get_absolute_time());
+	if (rate_state < LIS3_RATE_COUNT) {
+		governor_stats.time_ms[rate_state] += now - rate_state_since_ms;
+		governor_stats.transitions++;
 	}
+	governor_stats.entries[state]++;
 
-	// Calculate elapsed time
-	uint32_t current_time = to_ms_since_boot(get_absolute_time());
-	uint32_t elapsed_time = current_time - no_movement_start_time;
+	rate_state = state;
+	rate_state_since_ms = now;
+	odr_hz = lis3_rates[state].odr_hz;
+	lis3_write_reg(CTRL_REG1, lis3_rates[state].ctrl_reg1);
 
-	// If 10 minutes have passed without movement, return true
-	if (elapsed_time >= NO_MOVEMENT_DURATION_MS) {
-		no_movement_timer_running = false;  // Stop the timer after detecting no movement
-		return true;  // No movement detected for 10 minutes
+	// ACT_DUR is counted in ODR periods, keep the inactivity time constant
+	if (act_duration_ms != 0) {
+		lis3_write_act_dur();
 	}
 
-	return false;  // No conclusion yet; keep checking
-}
\ No newline at end of file
+	if (state == LIS3_RATE_CLASSIFY) {
+		classify_until_ms = now + LIS3_CLASSIFY_HOLD_MS;
+	}
+}
+
+lis3_rate_state_t LIS3_get_rate_state() {
+	return rate_state;
+}
+
+void LIS3_governor_poll() {
+	if (rate_state != LIS3_RATE_CLASSIFY) {
+		return;
+	}
+
+	uint32_t now = to_ms_since_boot(get_absolute_time());
+	if ((int32_t) (now - classify_until_ms) >= 0) {
+		LIS3_set_rate_state(LIS3_RATE_IDLE);
+	}
+}
+
+void LIS3_get_governor_stats(lis3_governor_stats_t *stats) {
+	*stats = governor_stats;
+	if (rate_state < LIS3_RATE_COUNT) {
+		stats->time_ms[rate_state] += to_ms_since_boot(get_absolute_time()) - rate_state_since_ms;
+	}
+}
@@ -2,7 +2,10 @@
 #define LIS3_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
+#include "hardware/i2c.h"
+#include "utils/reg_cache.h"
 
 #define LIS3_I2C_ADDR 0x18
 #define LIS3_I2C_FREQ 400000  //400 khz
@@ -12,6 +15,13 @@
 #define CTRL_REG3 0x22
 #define CTRL_REG4 0x23
 #define CTRL_REG5 0x24
+#define CTRL_REG6 0x25
+
+#define FIFO_CTRL_REG 0x2E
+#define FIFO_SRC_REG 0x2F
+
+#define ACT_THS 0x3E
+#define ACT_DUR 0x3F
 
 #define INT1_CFG 0x30
 #define INT1_THS 0x32
@@ -25,6 +35,36 @@
 #define OUT_Z_L 0x2C
 #define OUT_Z_H 0x2D
 
+// setting the MSB of the sub-address enables register auto-increment
+#define LIS3_AUTO_INCREMENT 0x80
+
+// CTRL_REG3 bits
+#define LIS3_I1_IA1 0x40      // interrupt activity 1 on INT1
+#define LIS3_I1_WTM 0x04      // FIFO watermark on INT1
+#define LIS3_I1_OVERRUN 0x02  // FIFO overrun on INT1
+
+// CTRL_REG6 bits
+#define LIS3_I2_ACT 0x08      // activity/inactivity status on INT2
+
+// CTRL_REG5 bits
+#define LIS3_FIFO_EN 0x40
+
+// FIFO_CTRL_REG modes (FM[1:0])
+#define LIS3_FIFO_MODE_BYPASS 0x00
+#define LIS3_FIFO_MODE_FIFO   0x40
+#define LIS3_FIFO_MODE_STREAM 0x80
+#define LIS3_FIFO_FTH_MASK    0x1F
+
+// FIFO_SRC_REG bits
+#define LIS3_FIFO_SRC_WTM  0x80
+#define LIS3_FIFO_SRC_OVRN 0x40
+#define LIS3_FIFO_SRC_EMPTY 0x20
+#define LIS3_FIFO_SRC_FSS_MASK 0x1F
+
+#define LIS3_FIFO_DEPTH 32
+
+#define LIS3_ACT_THS_MG 16    // ACT_THS LSB at +-2 g full scale
+
 typedef struct
 {
     float x;
@@ -32,6 +72,31 @@ typedef struct
     float z;
 } lis3_data_t;
 
+// raw left-justified output registers, as read from OUT_X_L..OUT_Z_H
+typedef struct
+{
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} lis3_raw_t;
+
+// ODR governor states, from lowest to highest sensor current
+typedef enum {
+    LIS3_RATE_SLEEP,     // device asleep, only wake-on-motion matters
+    LIS3_RATE_IDLE,      // awake, waiting for the inactivity interrupt
+    LIS3_RATE_CLASSIFY,  // after motion, FIFO samples feed the motion engine until it ends
+    LIS3_RATE_COUNT
+} lis3_rate_state_t;
+
+typedef struct {
+    uint32_t transitions;
+    uint32_t entries[LIS3_RATE_COUNT];
+    uint32_t time_ms[LIS3_RATE_COUNT];
+} lis3_governor_stats_t;
+
+// called from LIS3_fifo_drain() with every sample that was waiting in the FIFO
+typedef void (*lis3_fifo_callback_t)(const lis3_raw_t *samples, uint8_t count, void *user_data);
+
 // initialize LIS3DH sensor
 void LIS3_init(i2c_inst_t *i2c_inst, int operation_mode);
 //void LIS3_init(int operation_mode);
@@ -42,10 +107,54 @@ void disable_movement_detection();
 
 float LIS3_read_axis(uint8_t reg_l, uint8_t reg_h);
 
+// read all three axes in a single 6-byte burst
+bool LIS3_read_raw(lis3_raw_t *raw);
+
+lis3_data_t LIS3_raw_to_g(const lis3_raw_t *raw);
+
 lis3_data_t LIS3_read_data();
 
-bool LIS3_is_moving();
+// number of I2C transactions issued by the driver (a register read counts as one)
+uint32_t LIS3_get_bus_transactions();
+
+// clears the transaction count with the other reg_cache counters
+void LIS3_reset_bus_transactions();
+
+// hit/miss counters of the configuration register shadow
+void LIS3_get_reg_cache_stats(reg_cache_stats_t *stats);
+
+// FIFO stream mode: the sensor buffers up to 32 samples and raises INT1 once
+// `watermark` samples are waiting; the caller drains them in one burst.
+// INT1 carries only the watermark until LIS3_fifo_disable() hands it back
+// to the IA1 wake-up interrupt.
+bool LIS3_fifo_enable(uint8_t watermark, lis3_fifo_callback_t callback, void *user_data);
+
+void LIS3_fifo_disable();
+
+// call from the INT1 GPIO interrupt while the FIFO is enabled, only marks it as ready
+void LIS3_fifo_notify();
+
+bool LIS3_fifo_pending();
+
+// reads every queued sample and hands them to the callback, returns the
+// number of samples drained or -1 on a bus error
+int LIS3_fifo_drain();
+
+// activity/inactivity engine: INT2 goes high once acceleration has stayed
+// below threshold_mg for duration_ms and drops back low on the next activity
+void LIS3_enable_activity_detection(uint16_t threshold_mg, uint32_t duration_ms);
+
+void LIS3_disable_activity_detection();
+
+// switch CTRL_REG1 ODR and power mode, ACT_DUR is rescaled to the new rate
+void LIS3_set_rate_state(lis3_rate_state_t state);
+
+lis3_rate_state_t LIS3_get_rate_state();
+
+// drops back from CLASSIFY to IDLE once LIS3_CLASSIFY_HOLD_MS has passed;
+// the acquisition loop leaves earlier when the motion engine sees the bout end
+void LIS3_governor_poll();
 
-bool check_no_movement_for_duration();
+void LIS3_get_governor_stats(lis3_governor_stats_t *stats);
 
 #endif //LIS3_H
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "motion.h"
+
+// activity decays by 1/16 per sample
+#define MOTION_ACTIVITY_SHIFT 4
+
+uint32_t motion_threshold_sq(uint16_t threshold_mg) {
+    uint32_t thr = (uint32_t) threshold_mg * MOTION_RAW_PER_MG;
+    return thr * thr;
+}
+
+void motion_init(motion_engine_t *m, uint16_t threshold_mg, uint16_t min_still_samples) {
+    m->threshold_sq = motion_threshold_sq(threshold_mg);
+    m->min_still_samples = min_still_samples;
+    m->activity = 0;
+    m->still_run = min_still_samples;
+    m->in_bout = false;
+    m->bouts = 0;
+    m->samples = 0;
+    m->moving_samples = 0;
+}
+
+void motion_enter_bout(motion_engine_t *m) {
+    m->in_bout = true;
+    m->still_run = 0;
+}
+
+bool motion_update(motion_engine_t *m, const lis3_raw_t *sample) {
+    bool moving = motion_sample_exceeds(sample, m->threshold_sq);
+
+    m->samples++;
+    m->activity -= m->activity >> MOTION_ACTIVITY_SHIFT;
+
+    if (moving) {
+        m->moving_samples++;
+        m->activity += 256 >> MOTION_ACTIVITY_SHIFT;
+
+        // a bout only starts after enough still samples, so one step or
+        // bump with a few quiet samples in between is not counted twice
+        if (!m->in_bout && m->still_run >= m->min_still_samples) {
+            m->bouts++;
+        }
+        m->in_bout = true;
+        m->still_run = 0;
+    } else {
+        if (m->still_run < UINT16_MAX) {
+            m->still_run++;
+        }
+        if (m->still_run >= m->min_still_samples) {
+            m->in_bout = false;
+        }
+    }
+
+    return moving;
+}
+
+uint8_t motion_update_batch(motion_engine_t *m, const lis3_raw_t *samples, uint8_t count) {
+    uint8_t moving = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (motion_update(m, &samples[i])) {
+            moving++;
+        }
+    }
+    return moving;
+}
+
+void motion_fifo_callback(const lis3_raw_t *samples, uint8_t count, void *user_data) {
+    motion_update_batch((motion_engine_t *) user_data, samples, count);
+}
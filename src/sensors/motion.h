@@ -0,0 +1,54 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lis3.h"
+
+// raw LIS3DH counts per mg (10-bit data left-justified, 4 mg per LSB)
+#define MOTION_RAW_PER_MG 16
+
+// integer-only motion engine working on raw samples, no FPU needed
+typedef struct {
+    uint32_t threshold_sq;       // squared magnitude threshold in raw counts
+    uint16_t min_still_samples;  // still samples needed before a new bout can start
+    uint16_t activity;           // running activity level, Q8 (256 = every recent sample moving)
+    uint16_t still_run;
+    bool in_bout;
+    uint32_t bouts;
+    uint32_t samples;
+    uint32_t moving_samples;
+} motion_engine_t;
+
+void motion_init(motion_engine_t *m, uint16_t threshold_mg, uint16_t min_still_samples);
+
+uint32_t motion_threshold_sq(uint16_t threshold_mg);
+
+// true when the sample magnitude exceeds the squared threshold
+static inline bool motion_sample_exceeds(const lis3_raw_t *s, uint32_t threshold_sq) {
+    int32_t x = s->x;
+    int32_t y = s->y;
+    int32_t z = s->z;
+    // three int16 squares always fit in 32 bits unsigned
+    uint32_t mag_sq = (uint32_t) (x * x) + (uint32_t) (y * y) + (uint32_t) (z * z);
+    return mag_sq > threshold_sq;
+}
+
+// the caller saw motion elsewhere (a wake-up interrupt, a raised rate); the
+// bout ends after min_still_samples quiet samples
+void motion_enter_bout(motion_engine_t *m);
+
+static inline bool motion_in_bout(const motion_engine_t *m) {
+    return m->in_bout;
+}
+
+// feed one polled sample, returns true if it counts as moving
+bool motion_update(motion_engine_t *m, const lis3_raw_t *sample);
+
+// feed a FIFO batch, returns how many samples were moving
+uint8_t motion_update_batch(motion_engine_t *m, const lis3_raw_t *samples, uint8_t count);
+
+// matches lis3_fifo_callback_t, user_data is the motion_engine_t
+void motion_fifo_callback(const lis3_raw_t *samples, uint8_t count, void *user_data);
+
+#endif //MOTION_H
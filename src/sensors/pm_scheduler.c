@@ -0,0 +1,257 @@
+#include "pm_scheduler.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "config/pin_config.h"
+#include "readiness.h"
+
+static pm_window_config_t cfg;
+static pm_window_state_t state = PM_WINDOW_OFF;
+
+// core1 runs the windows, core0 powers the fan ahead of a sleep wake-up
+static spin_lock_t *fan_lock;
+static bool fan_on = false;
+static uint64_t fan_on_since_us;
+static uint64_t fan_on_total_us;
+static uint32_t fan_starts;                 // off to on transitions
+static uint64_t init_us;
+static uint64_t window_start_us;
+static uint64_t last_read_us;
+
+static pm_readiness_t readiness;
+static uint32_t readiness_run;              // fan_starts value the detector belongs to
+static uint32_t sums[12];
+static uint8_t frames_collected;
+static pm_scheduler_stats_t stats;
+
+void pm_scheduler_power(bool on) {
+    uint32_t save = spin_lock_blocking(fan_lock);
+    uint64_t now = time_us_64();
+    if (on && !fan_on) {
+        fan_on_since_us = now;
+        fan_starts++;
+    } else if (!on && fan_on) {
+        fan_on_total_us += now - fan_on_since_us;
+    }
+    fan_on = on;
+    gpio_put(PM25_SET_PIN, on);
+    spin_unlock(fan_lock, save);
+}
+
+// consistent copy of the fan state written by pm_scheduler_power
+static bool fan_snapshot(uint64_t *since_us, uint32_t *starts) {
+    uint32_t save = spin_lock_blocking(fan_lock);
+    bool on = fan_on;
+    *since_us = fan_on_since_us;
+    *starts = fan_starts;
+    spin_unlock(fan_lock, save);
+    return on;
+}
+
+// a fan switched on outside a window, e.g. by the sleep pre-wake, starts a
+// new warm-up; one that kept running keeps the detector's progress
+static bool sync_readiness(void) {
+    uint64_t since_us;
+    uint32_t starts;
+    bool on = fan_snapshot(&since_us, &starts);
+    if (readiness_run != starts) {
+        readiness_run = starts;
+        pm_readiness_start(&readiness, (uint32_t) (since_us / 1000), cfg.spinup_ms + cfg.stabilise_ms);
+    }
+    return on;
+}
+
+static void start_window(uint64_t now) {
+    window_start_us = now;
+    frames_collected = 0;
+    memset(sums, 0, sizeof(sums));
+    pm_scheduler_power(true); // no-op for a fan that is already running
+    state = PM_WINDOW_SPINUP;
+}
+
+void pm_scheduler_init(const pm_window_config_t *config) {
+    cfg = *config;
+    if (cfg.frames == 0) {
+        cfg.frames = 1;
+    }
+
+    if (!fan_lock) {
+        fan_lock = spin_lock_instance(spin_lock_claim_unused(true));
+    }
+    memset(&stats, 0, sizeof(stats));
+    fan_on_total_us = 0;
+    init_us = time_us_64();
+    start_window(init_us);
+}
+
+static void accumulate(const pmsa003_data_t *d) {
+    const uint16_t values[12] = {
+        d->pm1_0_standard, d->pm2_5_standard, d->pm10_standard,
+        d->pm1_0_env, d->pm2_5_env, d->pm10_env,
+        d->particles_03um, d->particles_05um, d->particles_10um,
+        d->particles_25um, d->particles_50um, d->particles_100um
+    };
+    for (int i = 0; i < 12; i++) {
+        sums[i] += values[i];
+    }
+    frames_collected++;
+}
+
+static void write_average(pmsa003_data_t *avg) {
+    uint16_t values[12];
+    for (int i = 0; i < 12; i++) {
+        // rounded integer mean
+        values[i] = (uint16_t) ((sums[i] + frames_collected / 2) / frames_collected);
+    }
+    avg->pm1_0_standard = values[0];
+    avg->pm2_5_standard = values[1];
+    avg->pm10_standard = values[2];
+    avg->pm1_0_env = values[3];
+    avg->pm2_5_env = values[4];
+    avg->pm10_env = values[5];
+    avg->particles_03um = values[6];
+    avg->particles_05um = values[7];
+    avg->particles_10um = values[8];
+    avg->particles_25um = values[9];
+    avg->particles_50um = values[10];
+    avg->particles_100um = values[11];
+}
+
+bool pm_scheduler_frame_due(void) {
+    return (state == PM_WINDOW_SAMPLING || state == PM_WINDOW_STABILISE)
+           && (last_read_us == 0 || time_us_64() - last_read_us >= PMSA003_UPDATE_PERIOD_MS * 1000);
+}
+
+bool pm_scheduler_poll(pmsa003_data_t *avg) {
+    uint64_t now = time_us_64();
+    uint64_t on_since_us;
+    uint32_t starts;
+    uint64_t since_on = fan_snapshot(&on_since_us, &starts) ? now - on_since_us : 0;
+
+    switch (state) {
+        case PM_WINDOW_OFF:
+            if (now - window_start_us >= (uint64_t) cfg.period_ms * 1000) {
+                start_window(now);
+            }
+            return false;
+
+        case PM_WINDOW_SPINUP:
+            if (since_on >= (uint64_t) cfg.spinup_ms * 1000) {
+                // measured from fan on, a fan left running keeps its progress
+                sync_readiness();
+                state = PM_WINDOW_STABILISE;
+                last_read_us = 0;
+            }
+            return false;
+
+        case PM_WINDOW_STABILISE: {
+            // reads frames while the airflow settles and moves on as soon as
+            // they agree, the configured time is only the upper bound
+            if (!readiness_check_timeout(&readiness.r, (uint32_t) (now / 1000))
+                    && (last_read_us == 0 || now - last_read_us >= PMSA003_UPDATE_PERIOD_MS * 1000)) {
+                pmsa003_data_t frame;
+                pmsa003_status_t status = pmsa003_read_frame(&frame);
+                if (status != PMSA003_DUPLICATE) {
+                    last_read_us = now;
+                }
+                if (status == PMSA003_OK) {
+                    pm_readiness_update(&readiness, frame.pm2_5_env, (uint32_t) (now / 1000));
+                }
+            }
+            if (readiness_ready(&readiness.r)) {
+                stats.last_ready_ms = readiness.r.ready_ms;
+                if (readiness.r.state == READINESS_TIMED_OUT) {
+                    stats.ready_timeouts++;
+                }
+                state = PM_WINDOW_SAMPLING;
+                last_read_us = 0;
+            }
+            return false;
+        }
+
+        case PM_WINDOW_SAMPLING: {
+            // the sensor only refreshes once per update period
+            if (last_read_us != 0 && now - last_read_us < PMSA003_UPDATE_PERIOD_MS * 1000) {
+                return false;
+            }
+
+            pmsa003_data_t frame;
+            pmsa003_status_t status = pmsa003_read_frame(&frame);
+            if (status == PMSA003_DUPLICATE) {
+                return false;   // retry on the next poll
+            }
+            last_read_us = now;
+            if (status != PMSA003_OK) {
+                return false;
+            }
+
+            accumulate(&frame);
+            if (frames_collected < cfg.frames) {
+                return false;
+            }
+
+            write_average(avg);
+            stats.windows++;
+            stats.frames += frames_collected;
+            pm_scheduler_power(false);
+            state = PM_WINDOW_OFF;
+            return true;
+        }
+
+        case PM_WINDOW_SUSPENDED:
+        default:
+            return false;
+    }
+}
+
+void pm_scheduler_suspend(void) {
+    pm_scheduler_power(false);
+    state = PM_WINDOW_SUSPENDED;
+}
+
+void pm_scheduler_resume(void) {
+    start_window(time_us_64());
+}
+
+void pm_scheduler_observe(const pmsa003_data_t *frame) {
+    if (sync_readiness()) {
+        pm_readiness_update(&readiness, frame->pm2_5_env, (uint32_t) (time_us_64() / 1000));
+    }
+}
+
+bool pm_scheduler_ready(void) {
+    if (sync_readiness()) {
+        readiness_check_timeout(&readiness.r, (uint32_t) (time_us_64() / 1000));
+    }
+    return readiness_ready(&readiness.r);
+}
+
+bool pm_scheduler_check_ready(void) {
+    if (pm_scheduler_ready()) {
+        return true;
+    }
+    uint64_t since_us;
+    uint32_t starts;
+    return fan_snapshot(&since_us, &starts) && time_us_64() - since_us >= (uint64_t) cfg.check_on_ms * 1000;
+}
+
+pm_window_state_t pm_scheduler_get_state(void) {
+    return state;
+}
+
+void pm_scheduler_get_stats(pm_scheduler_stats_t *out) {
+    uint32_t save = spin_lock_blocking(fan_lock);
+    uint64_t now = time_us_64();
+    uint64_t on_us = fan_on_total_us;
+    if (fan_on) {
+        on_us += now - fan_on_since_us;
+    }
+    spin_unlock(fan_lock, save);
+
+    *out = stats;
+    out->on_ms = (uint32_t) (on_us / 1000);
+    out->total_ms = (uint32_t) ((now - init_us) / 1000);
+    out->duty_permille = out->total_ms ? (uint16_t) ((uint64_t) out->on_ms * 1000 / out->total_ms) : 0;
+}
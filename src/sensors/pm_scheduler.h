@@ -0,0 +1,70 @@
+#ifndef PM_SCHEDULER_H
+#define PM_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pmsa003.h"
+
+// duty-cycled PMSA003 sampling: the fan only runs during a window of
+// spin-up, stabilisation and N frames, then stays off until the next period
+typedef struct {
+    uint32_t spinup_ms;     // fan start-up, frames are not read
+    uint32_t stabilise_ms;  // upper bound for airflow settling, ends early once frames agree
+    uint8_t frames;         // fresh frames averaged per window
+    uint32_t period_ms;     // window start to window start
+    uint32_t check_on_ms;   // fan-on time after which a check burst frame counts as settled
+} pm_window_config_t;
+
+typedef enum {
+    PM_WINDOW_OFF,
+    PM_WINDOW_SPINUP,
+    PM_WINDOW_STABILISE,
+    PM_WINDOW_SAMPLING,
+    PM_WINDOW_SUSPENDED     // sleep mode owns the fan
+} pm_window_state_t;
+
+typedef struct {
+    uint32_t windows;       // completed windows
+    uint32_t frames;        // frames averaged over all windows
+    uint32_t on_ms;         // time with the SET pin high
+    uint32_t total_ms;      // time since pm_scheduler_init()
+    uint16_t duty_permille; // on_ms / total_ms
+    uint32_t last_ready_ms; // fan on to settled frames in the latest window
+    uint32_t ready_timeouts;// windows that reached the stabilisation bound
+} pm_scheduler_stats_t;
+
+void pm_scheduler_init(const pm_window_config_t *config);
+
+// call from the main loop, returns true when a window-averaged reading was written to avg
+bool pm_scheduler_poll(pmsa003_data_t *avg);
+
+// true when the next poll will read a frame, so it can be prefetched
+bool pm_scheduler_frame_due(void);
+
+// switch the fan through the SET pin; the fan state is guarded by a spin
+// lock, so core0 may call this while core1 runs the windows
+void pm_scheduler_power(bool on);
+
+// stop windows and turn the fan off, e.g. before entering sleep
+void pm_scheduler_suspend(void);
+
+// start a window now, a fan that is already running keeps its warm-up progress
+void pm_scheduler_resume(void);
+
+// feeds a frame read outside the scheduler's windows to the warm-up detector
+void pm_scheduler_observe(const pmsa003_data_t *frame);
+
+// readings of the current (or, with the fan off, the last) fan run have
+// settled; false while the fan is still warming up
+bool pm_scheduler_ready(void);
+
+// for the frames of a check burst: the sleep pre-wake runs the fan for too
+// short a time to fill the frame detector, so they also count once the fan
+// has been on for check_on_ms
+bool pm_scheduler_check_ready(void);
+
+pm_window_state_t pm_scheduler_get_state(void);
+
+void pm_scheduler_get_stats(pm_scheduler_stats_t *stats);
+
+#endif //PM_SCHEDULER_H
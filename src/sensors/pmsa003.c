@@ -1,42 +1,112 @@
 #include "pmsa003.h"
 #include <stdio.h>
+#include <string.h>
 #include <hardware/flash.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "pico/binary_info.h"
+#include "utils/i2c_dma.h"
+#include "config/config.h"
 
 static i2c_inst_t *i2c_port;
+static i2c_dma_device_t i2c_dev;
+static i2c_dma_txn_t prefetch_txn;
+
+static pmsa003_stats_t stats;
+static uint8_t last_frame[PMSA003_FRAME_LEN];
+static bool have_last_frame = false;
+static uint32_t last_frame_ms;
+
+typedef enum {
+    PREFETCH_NONE,
+    PREFETCH_PENDING,
+    PREFETCH_DONE,
+    PREFETCH_FAILED
+} prefetch_state_t;
+
+static uint8_t prefetch_buf[PMSA003_FRAME_LEN];
+static volatile prefetch_state_t prefetch_state = PREFETCH_NONE;
 
 void pmsa003_init(i2c_inst_t *i2c_inst) {
     i2c_port = i2c_inst;
 
-    i2c_init(i2c_port, 100 * 1000);
-    gpio_set_function(SDA_PIN, GPIO_FUNC_I2C);
-    gpio_set_function(SCL_PIN, GPIO_FUNC_I2C);
-    gpio_pull_up(SDA_PIN);
-    gpio_pull_up(SCL_PIN);
+    i2c_dma_init(i2c_port, I2C1_FREQ, SDA_PIN, SCL_PIN);
+    i2c_dma_device_init(&i2c_dev, i2c_port, PMSA003I_I2C_ADDR, I2C_DMA_PRIO_NORMAL, PMSA003_I2C_TIMEOUT_US, "PMSA003");
 
     bi_decl(bi_2pins_with_func(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C));
 
+    have_last_frame = false;
+    prefetch_state = PREFETCH_NONE;
     sleep_ms(1000);
 }
 
-bool pmsa003_read_data(pmsa003_data_t *data) {
-    uint8_t buffer[32];
+static void prefetch_done(int result, void *user_data) {
+    prefetch_state = result == PMSA003_FRAME_LEN ? PREFETCH_DONE : PREFETCH_FAILED;
+}
 
-    int ret = i2c_read_blocking(i2c_port, PMSA003I_I2C_ADDR, buffer, 32, false);
+void pmsa003_prefetch(void) {
+    if (prefetch_state != PREFETCH_NONE) {
+        return;
+    }
+    prefetch_txn = (i2c_dma_txn_t) {
+        .dev = &i2c_dev, .dst = prefetch_buf, .rlen = PMSA003_FRAME_LEN, .callback = prefetch_done
+    };
+    prefetch_state = PREFETCH_PENDING;
+    i2c_dma_submit(&prefetch_txn);
+}
 
-    if (ret != 32) {
-        return false;
+// first 32 bytes of a frame read, from the prefetch if one was started
+static int read_window(uint8_t *window) {
+    if (prefetch_state == PREFETCH_NONE) {
+        return i2c_dma_transfer_blocking(&i2c_dev, NULL, 0, window, PMSA003_FRAME_LEN);
+    }
+    while (prefetch_state == PREFETCH_PENDING) {
+        i2c_dma_poll(i2c_port);
+        best_effort_wfe_or_timeout(make_timeout_time_us(PMSA003_I2C_TIMEOUT_US));
+    }
+    bool ok = prefetch_state == PREFETCH_DONE;
+    prefetch_state = PREFETCH_NONE;
+    if (!ok) {
+        return PICO_ERROR_GENERIC;
     }
+    memcpy(window, prefetch_buf, PMSA003_FRAME_LEN);
+    return PMSA003_FRAME_LEN;
+}
 
-    if (buffer[0] != 0x42 || buffer[1] != 0x4D) {
-        return false;
+int pmsa003_find_start(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i + 1 < len; i++) {
+        if (buf[i] == PMSA003_START_1 && buf[i + 1] == PMSA003_START_2) {
+            return (int) i;
+        }
     }
+    return -1;
+}
 
-    uint16_t values[6];
-    for (int i = 0; i < 6; i++) {
-        values[i] = (buffer[4 + (i * 2)] << 8) | buffer[5 + (i * 2)];
+static uint16_t read_be16(const uint8_t *p) {
+    return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+pmsa003_status_t pmsa003_parse_frame(const uint8_t *frame, pmsa003_data_t *data) {
+    if (frame[0] != PMSA003_START_1 || frame[1] != PMSA003_START_2) {
+        return PMSA003_ERR_HEADER;
+    }
+
+    if (read_be16(&frame[2]) != PMSA003_FRAME_DATA_LEN) {
+        return PMSA003_ERR_LENGTH;
+    }
+
+    // checksum is the sum of every byte before it
+    uint16_t sum = 0;
+    for (int i = 0; i < PMSA003_FRAME_LEN - 2; i++) {
+        sum += frame[i];
+    }
+    if (sum != read_be16(&frame[PMSA003_FRAME_LEN - 2])) {
+        return PMSA003_ERR_CHECKSUM;
+    }
+
+    uint16_t values[12];
+    for (int i = 0; i < 12; i++) {
+        values[i] = read_be16(&frame[4 + (i * 2)]);
     }
 
     data->pm1_0_standard = values[0];
@@ -45,6 +115,98 @@ bool pmsa003_read_data(pmsa003_data_t *data) {
     data->pm1_0_env = values[3];
     data->pm2_5_env = values[4];
     data->pm10_env = values[5];
+    data->particles_03um = values[6];
+    data->particles_05um = values[7];
+    data->particles_10um = values[8];
+    data->particles_25um = values[9];
+    data->particles_50um = values[10];
+    data->particles_100um = values[11];
+
+    return PMSA003_OK;
+}
+
+// reads one frame; if the start bytes are not at offset 0 the rest of the
+// misaligned frame is read in a second transfer and decoded from the window
+static pmsa003_status_t read_aligned_frame(uint8_t *frame) {
+    uint8_t window[PMSA003_FRAME_LEN * 2];
+
+    int ret = read_window(window);
+    if (ret != PMSA003_FRAME_LEN) {
+        return PMSA003_ERR_I2C;
+    }
+
+    int start = pmsa003_find_start(window, PMSA003_FRAME_LEN);
+    if (start == 0) {
+        memcpy(frame, window, PMSA003_FRAME_LEN);
+        return PMSA003_OK;
+    }
+
+    // a start byte may be the very last byte of the window
+    if (start < 0 && window[PMSA003_FRAME_LEN - 1] == PMSA003_START_1) {
+        start = PMSA003_FRAME_LEN - 1;
+    }
+    if (start < 0) {
+        return PMSA003_ERR_HEADER;
+    }
+
+    stats.resyncs++;
+    ret = i2c_dma_transfer_blocking(&i2c_dev, NULL, 0, &window[PMSA003_FRAME_LEN], start);
+    if (ret != start) {
+        return PMSA003_ERR_I2C;
+    }
+
+    memcpy(frame, &window[start], PMSA003_FRAME_LEN);
+    return PMSA003_OK;
+}
+
+pmsa003_status_t pmsa003_read_frame(pmsa003_data_t *data) {
+    uint8_t frame[PMSA003_FRAME_LEN];
+    pmsa003_data_t decoded;
+
+    pmsa003_status_t status = read_aligned_frame(frame);
+    if (status == PMSA003_OK) {
+        status = pmsa003_parse_frame(frame, &decoded);
+    }
+
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    if (status == PMSA003_OK && have_last_frame
+            && now - last_frame_ms < PMSA003_UPDATE_PERIOD_MS
+            && memcmp(frame, last_frame, PMSA003_FRAME_LEN) == 0) {
+        status = PMSA003_DUPLICATE;
+    }
+
+    switch (status) {
+        case PMSA003_OK:
+            stats.frames_ok++;
+            memcpy(last_frame, frame, PMSA003_FRAME_LEN);
+            have_last_frame = true;
+            last_frame_ms = now;
+            *data = decoded;
+            break;
+        case PMSA003_ERR_I2C:
+            stats.i2c_errors++;
+            break;
+        case PMSA003_ERR_HEADER:
+            stats.header_errors++;
+            break;
+        case PMSA003_ERR_LENGTH:
+            stats.length_errors++;
+            break;
+        case PMSA003_ERR_CHECKSUM:
+            stats.checksum_errors++;
+            break;
+        case PMSA003_DUPLICATE:
+            stats.duplicates++;
+            break;
+    }
+
+    return status;
+}
+
+bool pmsa003_read_data(pmsa003_data_t *data) {
+    return pmsa003_read_frame(data) == PMSA003_OK;
+}
 
-    return true;
+void pmsa003_get_stats(pmsa003_stats_t *out) {
+    *out = stats;
 }
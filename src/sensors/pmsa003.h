@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "hardware/i2c.h"
 
 #define I2C_PORT i2c1
@@ -10,6 +11,12 @@
 #define SDA_PIN 14  // GPIO 14 (Pin 19)
 #define SCL_PIN 15  // GPIO 15 (Pin 20)
 
+#define PMSA003_FRAME_LEN 32
+#define PMSA003_FRAME_DATA_LEN 28   // value of the frame length field
+#define PMSA003_START_1 0x42
+#define PMSA003_START_2 0x4D
+#define PMSA003_UPDATE_PERIOD_MS 1000  // sensor refreshes its output about once per second
+
 typedef struct {
     uint16_t pm1_0_standard;
     uint16_t pm2_5_standard;
@@ -17,9 +24,51 @@ typedef struct {
     uint16_t pm1_0_env;
     uint16_t pm2_5_env;
     uint16_t pm10_env;
+    // particles beyond the given diameter per 0.1 L of air
+    uint16_t particles_03um;
+    uint16_t particles_05um;
+    uint16_t particles_10um;
+    uint16_t particles_25um;
+    uint16_t particles_50um;
+    uint16_t particles_100um;
 } pmsa003_data_t;
 
+typedef enum {
+    PMSA003_OK,
+    PMSA003_ERR_I2C,
+    PMSA003_ERR_HEADER,     // no start bytes in the read window
+    PMSA003_ERR_LENGTH,
+    PMSA003_ERR_CHECKSUM,
+    PMSA003_DUPLICATE       // same frame as last time, sensor has not updated yet
+} pmsa003_status_t;
+
+typedef struct {
+    uint32_t frames_ok;
+    uint32_t i2c_errors;
+    uint32_t header_errors;
+    uint32_t length_errors;
+    uint32_t checksum_errors;
+    uint32_t duplicates;
+    uint32_t resyncs;
+} pmsa003_stats_t;
+
 void pmsa003_init(i2c_inst_t *i2c);
+
+// true only for a new frame that passed header, length and checksum checks
 bool pmsa003_read_data(pmsa003_data_t *data);
 
-#endif //PMSA003_H
\ No newline at end of file
+pmsa003_status_t pmsa003_read_frame(pmsa003_data_t *data);
+
+// starts reading the next frame in the background; the following
+// pmsa003_read_frame() uses it instead of going to the bus
+void pmsa003_prefetch(void);
+
+// decodes one complete 32-byte frame starting at frame[0]
+pmsa003_status_t pmsa003_parse_frame(const uint8_t *frame, pmsa003_data_t *data);
+
+// index of the first start sequence in buf, or -1 if there is none
+int pmsa003_find_start(const uint8_t *buf, size_t len);
+
+void pmsa003_get_stats(pmsa003_stats_t *stats);
+
+#endif //PMSA003_H
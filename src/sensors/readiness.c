@@ -0,0 +1,97 @@
+#include "readiness.h"
+#include <string.h>
+
+static void readiness_start(readiness_t *r, uint32_t now_ms, uint32_t max_ms) {
+    r->state = READINESS_WARMING;
+    r->start_ms = now_ms;
+    r->max_ms = max_ms;
+    r->ready_ms = 0;
+}
+
+static void declare(readiness_t *r, readiness_state_t state, uint32_t now_ms) {
+    r->state = state;
+    r->ready_ms = now_ms - r->start_ms;
+}
+
+bool readiness_check_timeout(readiness_t *r, uint32_t now_ms) {
+    if (r->state == READINESS_WARMING && now_ms - r->start_ms >= r->max_ms) {
+        declare(r, READINESS_TIMED_OUT, now_ms);
+    }
+    return readiness_ready(r);
+}
+
+void gas_readiness_start(gas_readiness_t *g, uint32_t now_ms, uint32_t max_ms) {
+    readiness_start(&g->r, now_ms, max_ms);
+    g->last_gas = 0;
+    g->last_ms = now_ms;
+    g->stable_run = 0;
+}
+
+bool gas_readiness_update(gas_readiness_t *g, uint32_t gas_resistance, bool heat_stable, uint32_t now_ms) {
+    if (readiness_ready(&g->r)) {
+        return true;
+    }
+
+    // a cold sensor reads low and climbs, ready once the climb has flattened out
+    if (!heat_stable || gas_resistance == 0) {
+        g->stable_run = 0;
+    } else if (g->last_gas != 0) {
+        // the samples of a check burst are much closer together than normal
+        // sampling, so the allowed change scales with the time between them
+        uint32_t diff = gas_resistance > g->last_gas ? gas_resistance - g->last_gas : g->last_gas - gas_resistance;
+        uint32_t dt_ms = now_ms - g->last_ms;
+        if ((uint64_t) diff * 1000 * 1000 <= (uint64_t) g->last_gas * READY_GAS_SLOPE_PERMILLE_S * dt_ms) {
+            g->stable_run++;
+        } else {
+            g->stable_run = 0;
+        }
+    }
+    g->last_gas = heat_stable ? gas_resistance : 0;
+    g->last_ms = now_ms;
+
+    if (g->stable_run >= READY_GAS_STABLE_SAMPLES) {
+        declare(&g->r, READINESS_CONVERGED, now_ms);
+        return true;
+    }
+    return readiness_check_timeout(&g->r, now_ms);
+}
+
+void pm_readiness_start(pm_readiness_t *p, uint32_t now_ms, uint32_t max_ms) {
+    readiness_start(&p->r, now_ms, max_ms);
+    memset(p->frames, 0, sizeof(p->frames));
+    p->count = 0;
+    p->next = 0;
+}
+
+bool pm_readiness_update(pm_readiness_t *p, uint16_t pm2_5, uint32_t now_ms) {
+    if (readiness_ready(&p->r)) {
+        return true;
+    }
+
+    p->frames[p->next] = pm2_5;
+    p->next = (uint8_t) ((p->next + 1) % READY_PM_FRAMES);
+    if (p->count < READY_PM_FRAMES) {
+        p->count++;
+    }
+
+    if (p->count == READY_PM_FRAMES) {
+        uint32_t sum = 0;
+        uint64_t sum_sq = 0;
+        for (int i = 0; i < READY_PM_FRAMES; i++) {
+            sum += p->frames[i];
+            sum_sq += (uint32_t) p->frames[i] * p->frames[i];
+        }
+        // n^2 * variance against n^2 * tolerance^2, no division
+        uint64_t n = READY_PM_FRAMES;
+        uint64_t var_n2 = n * sum_sq - (uint64_t) sum * sum;
+        uint64_t tol_n = (uint64_t) sum * READY_PM_REL_TOL_PCT / 100;
+        if (tol_n < READY_PM_ABS_TOL * n) {
+            tol_n = READY_PM_ABS_TOL * n;
+        }
+        if (var_n2 <= tol_n * tol_n) {
+            declare(&p->r, READINESS_CONVERGED, now_ms);
+            return true;
+        }
+    }
+    return readiness_check_timeout(&p->r, now_ms);
+}
@@ -0,0 +1,64 @@
+#ifndef READINESS_H
+#define READINESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Per-channel warm-up detection. Each detector watches the readings of one
+// sensor channel after it was switched on and declares it ready as soon as
+// they converge, or once the fallback bound has passed. Fixed size state,
+// integer math, fed one reading at a time.
+
+#define READY_GAS_STABLE_SAMPLES    3       //consecutive heater-stable samples with a flat gas reading
+#define READY_GAS_SLOPE_PERMILLE_S  5       //|change| per second relative to the previous reading, 3.5% over a 7 s sample period
+#define READY_PM_FRAMES             5       //frames in the PM variance window
+#define READY_PM_ABS_TOL            2       //ug/m3, standard deviation accepted at low concentrations
+#define READY_PM_REL_TOL_PCT        10      //standard deviation relative to the mean otherwise
+
+typedef enum {
+    READINESS_WARMING,
+    READINESS_CONVERGED,
+    READINESS_TIMED_OUT     // fallback bound reached before the readings settled
+} readiness_state_t;
+
+typedef struct {
+    readiness_state_t state;
+    uint32_t start_ms;
+    uint32_t max_ms;        // fallback upper bound
+    uint32_t ready_ms;      // start to ready, valid once no longer warming
+} readiness_t;
+
+// BME680 gas channel: the heater-stable and gas-valid bits plus the gas
+// resistance derivative
+typedef struct {
+    readiness_t r;
+    uint32_t last_gas;
+    uint32_t last_ms;
+    uint8_t stable_run;
+} gas_readiness_t;
+
+// PMSA003: variance of PM2.5 over the last few frames
+typedef struct {
+    readiness_t r;
+    uint16_t frames[READY_PM_FRAMES];
+    uint8_t count;
+    uint8_t next;
+} pm_readiness_t;
+
+void gas_readiness_start(gas_readiness_t *g, uint32_t now_ms, uint32_t max_ms);
+
+// returns true once ready, converged or timed out
+bool gas_readiness_update(gas_readiness_t *g, uint32_t gas_resistance, bool heat_stable, uint32_t now_ms);
+
+void pm_readiness_start(pm_readiness_t *p, uint32_t now_ms, uint32_t max_ms);
+
+bool pm_readiness_update(pm_readiness_t *p, uint16_t pm2_5, uint32_t now_ms);
+
+// applies the fallback bound without a new reading
+bool readiness_check_timeout(readiness_t *r, uint32_t now_ms);
+
+static inline bool readiness_ready(const readiness_t *r) {
+    return r->state != READINESS_WARMING;
+}
+
+#endif //READINESS_H
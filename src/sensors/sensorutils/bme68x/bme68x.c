@@ -42,6 +42,15 @@
 /* This internal API is used to read the calibration coefficients */
 static int8_t get_calib_data(struct bme68x_dev *dev);
 
+/* This internal API is used to decode the coefficients read from BME68X_REG_COEFF1 */
+static void parse_calib_coeff1(const uint8_t *coeff_array, struct bme68x_calib_data *calib);
+
+/* This internal API is used to decode the coefficients read from BME68X_REG_COEFF2 and BME68X_REG_COEFF3 */
+static void parse_calib_coeff23(const uint8_t *coeff_array, struct bme68x_calib_data *calib);
+
+/* This internal API is used to compare the coefficients decoded by parse_calib_coeff23 */
+static int8_t calib_coeff23_equal(const struct bme68x_calib_data *a, const struct bme68x_calib_data *b);
+
 /* This internal API is used to read variant ID information register status */
 static int8_t read_variant_id(struct bme68x_dev *dev);
 
@@ -96,6 +105,9 @@ static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bm
 /* This internal API is used to read all data fields of the sensor */
 static int8_t read_all_field_data(struct bme68x_data * const data[], struct bme68x_dev *dev);
 
+/* This internal API is used to decode and compensate one raw data field */
+static void parse_field_data(const uint8_t *buff, struct bme68x_data *data, struct bme68x_dev *dev);
+
 /* This internal API is used to switch between SPI memory pages */
 static int8_t set_mem_page(uint8_t reg_addr, struct bme68x_dev *dev);
 
@@ -171,6 +183,71 @@ int8_t bme68x_init(struct bme68x_dev *dev)
     return rslt;
 }
 
+/* @brief This API verifies the chip-id like bme68x_init but takes the variant ID
+* and calibration coefficients already stored in dev, so the 23-byte
+* temperature/pressure block is not read. The variant ID and the
+* BME68X_REG_COEFF2 and BME68X_REG_COEFF3 blocks (humidity, par_t1, gas and
+* heater coefficients) are read back to check that the stored data belongs to
+* the attached sensor.
+*/
+int8_t bme68x_init_with_calib(struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t variant_id = 0;
+    uint8_t coeff_array[BME68X_LEN_COEFF_ALL] = { 0 };
+    struct bme68x_calib_data calib;
+
+    (void) bme68x_soft_reset(dev);
+
+    rslt = bme68x_get_regs(BME68X_REG_CHIP_ID, &dev->chip_id, 1, dev);
+
+    if (rslt == BME68X_OK)
+    {
+        if (dev->chip_id == BME68X_CHIP_ID)
+        {
+            rslt = bme68x_get_regs(BME68X_REG_VARIANT_ID, &variant_id, 1, dev);
+        }
+        else
+        {
+            rslt = BME68X_E_DEV_NOT_FOUND;
+        }
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        rslt = bme68x_get_regs(BME68X_REG_COEFF2, &coeff_array[BME68X_LEN_COEFF1], BME68X_LEN_COEFF2, dev);
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        rslt = bme68x_get_regs(BME68X_REG_COEFF3,
+                               &coeff_array[BME68X_LEN_COEFF1 + BME68X_LEN_COEFF2],
+                               BME68X_LEN_COEFF3,
+                               dev);
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        parse_calib_coeff23(coeff_array, &calib);
+        if ((variant_id != dev->variant_id) || !calib_coeff23_equal(&calib, &dev->calib))
+        {
+            rslt = read_variant_id(dev);
+
+            if (rslt == BME68X_OK)
+            {
+                rslt = get_calib_data(dev);
+            }
+
+            if (rslt == BME68X_OK)
+            {
+                rslt = BME68X_W_CALIB_RELOADED;
+            }
+        }
+    }
+
+    return rslt;
+}
+
 /*
  * @brief This API writes the given data to the register address of the sensor
  */
@@ -288,6 +365,9 @@ int8_t bme68x_soft_reset(struct bme68x_dev *dev)
         {
             rslt = bme68x_set_regs(&reg_addr, &soft_rst_cmd, 1, dev);
 
+            /* Heater registers are back to their reset values */
+            dev->heatr_shadow_len = 0;
+
             if (rslt == BME68X_OK)
             {
                 /* Wait for 5ms */
@@ -624,6 +704,50 @@ int8_t bme68x_get_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_dat
     return rslt;
 }
 
+/*
+ * @brief This API reads forced-mode data in a single burst using the cached
+ * heater settings.
+ */
+int8_t bme68x_get_forced_data_burst(struct bme68x_data *data, struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t buff[BME68X_LEN_FIELD] = { 0 };
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (data != NULL))
+    {
+        if (dev->heatr_shadow_len == 0)
+        {
+            /* Heater was not configured through this driver, read back the slow way */
+            uint8_t n_data;
+
+            return bme68x_get_data(BME68X_FORCED_MODE, data, &n_data, dev);
+        }
+
+        rslt = bme68x_get_regs(BME68X_REG_FIELD0, buff, (uint32_t) BME68X_LEN_FIELD, dev);
+        if (rslt == BME68X_OK)
+        {
+            parse_field_data(buff, data, dev);
+            if (!(data->status & BME68X_NEW_DATA_MSK))
+            {
+                rslt = BME68X_W_NO_NEW_DATA;
+            }
+            else if (data->gas_index < dev->heatr_shadow_len)
+            {
+                data->res_heat = dev->res_heat_shadow[data->gas_index];
+                data->gas_wait = dev->gas_wait_shadow[data->gas_index];
+                data->idac = 0; /* not programmed by the host */
+            }
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
 /*
  * @brief This API is used to set the gas configuration of the sensor.
  */
@@ -1201,11 +1325,6 @@ static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bm
 {
     int8_t rslt = BME68X_OK;
     uint8_t buff[BME68X_LEN_FIELD] = { 0 };
-    uint8_t gas_range_l, gas_range_h;
-    uint32_t adc_temp;
-    uint32_t adc_pres;
-    uint16_t adc_hum;
-    uint16_t adc_gas_res_low, adc_gas_res_high;
     uint8_t tries = 5;
 
     while ((tries) && (rslt == BME68X_OK))
@@ -1220,27 +1339,9 @@ static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bm
             break;
         }
 
-        data->status = buff[0] & BME68X_NEW_DATA_MSK;
-        data->gas_index = buff[0] & BME68X_GAS_INDEX_MSK;
-        data->meas_index = buff[1];
-
-        /* read the raw data from the sensor */
-        adc_pres = (uint32_t)(((uint32_t)buff[2] * 4096) | ((uint32_t)buff[3] * 16) | ((uint32_t)buff[4] / 16));
-        adc_temp = (uint32_t)(((uint32_t)buff[5] * 4096) | ((uint32_t)buff[6] * 16) | ((uint32_t)buff[7] / 16));
-        adc_hum = (uint16_t)(((uint32_t)buff[8] * 256) | (uint32_t)buff[9]);
-        adc_gas_res_low = (uint16_t)((uint32_t)buff[13] * 4 | (((uint32_t)buff[14]) / 64));
-        adc_gas_res_high = (uint16_t)((uint32_t)buff[15] * 4 | (((uint32_t)buff[16]) / 64));
-        gas_range_l = buff[14] & BME68X_GAS_RANGE_MSK;
-        gas_range_h = buff[16] & BME68X_GAS_RANGE_MSK;
-        if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
-        {
-            data->status |= buff[16] & BME68X_GASM_VALID_MSK;
-            data->status |= buff[16] & BME68X_HEAT_STAB_MSK;
-        }
-        else
+        if (rslt == BME68X_OK)
         {
-            data->status |= buff[14] & BME68X_GASM_VALID_MSK;
-            data->status |= buff[14] & BME68X_HEAT_STAB_MSK;
+            parse_field_data(buff, data, dev);
         }
 
         if ((data->status & BME68X_NEW_DATA_MSK) && (rslt == BME68X_OK))
@@ -1258,18 +1359,6 @@ static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bm
 
             if (rslt == BME68X_OK)
             {
-                data->temperature = calc_temperature(adc_temp, dev);
-                data->pressure = calc_pressure(adc_pres, dev);
-                data->humidity = calc_humidity(adc_hum, dev);
-                if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
-                {
-                    data->gas_resistance = calc_gas_resistance_high(adc_gas_res_high, gas_range_h);
-                }
-                else
-                {
-                    data->gas_resistance = calc_gas_resistance_low(adc_gas_res_low, gas_range_l, dev);
-                }
-
                 break;
             }
         }
@@ -1285,6 +1374,54 @@ static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bm
     return rslt;
 }
 
+/* This internal API is used to decode and compensate one raw data field */
+static void parse_field_data(const uint8_t *buff, struct bme68x_data *data, struct bme68x_dev *dev)
+{
+    uint8_t gas_range_l, gas_range_h;
+    uint32_t adc_temp;
+    uint32_t adc_pres;
+    uint16_t adc_hum;
+    uint16_t adc_gas_res_low, adc_gas_res_high;
+
+    data->status = buff[0] & BME68X_NEW_DATA_MSK;
+    data->gas_index = buff[0] & BME68X_GAS_INDEX_MSK;
+    data->meas_index = buff[1];
+
+    /* read the raw data from the sensor */
+    adc_pres = (uint32_t)(((uint32_t)buff[2] * 4096) | ((uint32_t)buff[3] * 16) | ((uint32_t)buff[4] / 16));
+    adc_temp = (uint32_t)(((uint32_t)buff[5] * 4096) | ((uint32_t)buff[6] * 16) | ((uint32_t)buff[7] / 16));
+    adc_hum = (uint16_t)(((uint32_t)buff[8] * 256) | (uint32_t)buff[9]);
+    adc_gas_res_low = (uint16_t)((uint32_t)buff[13] * 4 | (((uint32_t)buff[14]) / 64));
+    adc_gas_res_high = (uint16_t)((uint32_t)buff[15] * 4 | (((uint32_t)buff[16]) / 64));
+    gas_range_l = buff[14] & BME68X_GAS_RANGE_MSK;
+    gas_range_h = buff[16] & BME68X_GAS_RANGE_MSK;
+    if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
+    {
+        data->status |= buff[16] & BME68X_GASM_VALID_MSK;
+        data->status |= buff[16] & BME68X_HEAT_STAB_MSK;
+    }
+    else
+    {
+        data->status |= buff[14] & BME68X_GASM_VALID_MSK;
+        data->status |= buff[14] & BME68X_HEAT_STAB_MSK;
+    }
+
+    if (data->status & BME68X_NEW_DATA_MSK)
+    {
+        data->temperature = calc_temperature(adc_temp, dev);
+        data->pressure = calc_pressure(adc_pres, dev);
+        data->humidity = calc_humidity(adc_hum, dev);
+        if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
+        {
+            data->gas_resistance = calc_gas_resistance_high(adc_gas_res_high, gas_range_h);
+        }
+        else
+        {
+            data->gas_resistance = calc_gas_resistance_low(adc_gas_res_low, gas_range_l, dev);
+        }
+    }
+}
+
 /* This internal API is used to read all data fields of the sensor */
 static int8_t read_all_field_data(struct bme68x_data * const data[], struct bme68x_dev *dev)
 {
@@ -1554,6 +1691,22 @@ static int8_t set_conf(const struct bme68x_heatr_conf *conf, uint8_t op_mode, ui
         rslt = bme68x_set_regs(gw_reg_addr, gw_reg_data, write_len, dev);
     }
 
+    /* Remember what was programmed so forced-mode reads need not read it back */
+    if (rslt == BME68X_OK)
+    {
+        for (i = 0; i < write_len; i++)
+        {
+            dev->res_heat_shadow[i] = rh_reg_data[i];
+            dev->gas_wait_shadow[i] = gw_reg_data[i];
+        }
+
+        dev->heatr_shadow_len = write_len;
+    }
+    else
+    {
+        dev->heatr_shadow_len = 0;
+    }
+
     return rslt;
 }
 
@@ -1787,58 +1940,73 @@ static int8_t get_calib_data(struct bme68x_dev *dev)
 
     if (rslt == BME68X_OK)
     {
-        /* Temperature related coefficients */
-        dev->calib.par_t1 =
-            (uint16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_T1_MSB], coeff_array[BME68X_IDX_T1_LSB]));
-        dev->calib.par_t2 =
-            (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_T2_MSB], coeff_array[BME68X_IDX_T2_LSB]));
-        dev->calib.par_t3 = (int8_t)(coeff_array[BME68X_IDX_T3]);
-
-        /* Pressure related coefficients */
-        dev->calib.par_p1 =
-            (uint16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P1_MSB], coeff_array[BME68X_IDX_P1_LSB]));
-        dev->calib.par_p2 =
-            (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P2_MSB], coeff_array[BME68X_IDX_P2_LSB]));
-        dev->calib.par_p3 = (int8_t)coeff_array[BME68X_IDX_P3];
-        dev->calib.par_p4 =
-            (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P4_MSB], coeff_array[BME68X_IDX_P4_LSB]));
-        dev->calib.par_p5 =
-            (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P5_MSB], coeff_array[BME68X_IDX_P5_LSB]));
-        dev->calib.par_p6 = (int8_t)(coeff_array[BME68X_IDX_P6]);
-        dev->calib.par_p7 = (int8_t)(coeff_array[BME68X_IDX_P7]);
-        dev->calib.par_p8 =
-            (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P8_MSB], coeff_array[BME68X_IDX_P8_LSB]));
-        dev->calib.par_p9 =
-            (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P9_MSB], coeff_array[BME68X_IDX_P9_LSB]));
-        dev->calib.par_p10 = (uint8_t)(coeff_array[BME68X_IDX_P10]);
-
-        /* Humidity related coefficients */
-        dev->calib.par_h1 =
-            (uint16_t)(((uint16_t)coeff_array[BME68X_IDX_H1_MSB] << 4) |
-                       (coeff_array[BME68X_IDX_H1_LSB] & BME68X_BIT_H1_DATA_MSK));
-        dev->calib.par_h2 =
-            (uint16_t)(((uint16_t)coeff_array[BME68X_IDX_H2_MSB] << 4) | ((coeff_array[BME68X_IDX_H2_LSB]) >> 4));
-        dev->calib.par_h3 = (int8_t)coeff_array[BME68X_IDX_H3];
-        dev->calib.par_h4 = (int8_t)coeff_array[BME68X_IDX_H4];
-        dev->calib.par_h5 = (int8_t)coeff_array[BME68X_IDX_H5];
-        dev->calib.par_h6 = (uint8_t)coeff_array[BME68X_IDX_H6];
-        dev->calib.par_h7 = (int8_t)coeff_array[BME68X_IDX_H7];
-
-        /* Gas heater related coefficients */
-        dev->calib.par_gh1 = (int8_t)coeff_array[BME68X_IDX_GH1];
-        dev->calib.par_gh2 =
-            (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_GH2_MSB], coeff_array[BME68X_IDX_GH2_LSB]));
-        dev->calib.par_gh3 = (int8_t)coeff_array[BME68X_IDX_GH3];
-
-        /* Other coefficients */
-        dev->calib.res_heat_range = ((coeff_array[BME68X_IDX_RES_HEAT_RANGE] & BME68X_RHRANGE_MSK) / 16);
-        dev->calib.res_heat_val = (int8_t)coeff_array[BME68X_IDX_RES_HEAT_VAL];
-        dev->calib.range_sw_err = ((int8_t)(coeff_array[BME68X_IDX_RANGE_SW_ERR] & BME68X_RSERROR_MSK)) / 16;
+        parse_calib_coeff1(coeff_array, &dev->calib);
+        parse_calib_coeff23(coeff_array, &dev->calib);
     }
 
     return rslt;
 }
 
+/* This internal API is used to decode the coefficients read from BME68X_REG_COEFF1 */
+static void parse_calib_coeff1(const uint8_t *coeff_array, struct bme68x_calib_data *calib)
+{
+    /* Temperature related coefficients */
+    calib->par_t2 = (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_T2_MSB], coeff_array[BME68X_IDX_T2_LSB]));
+    calib->par_t3 = (int8_t)(coeff_array[BME68X_IDX_T3]);
+
+    /* Pressure related coefficients */
+    calib->par_p1 = (uint16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P1_MSB], coeff_array[BME68X_IDX_P1_LSB]));
+    calib->par_p2 = (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P2_MSB], coeff_array[BME68X_IDX_P2_LSB]));
+    calib->par_p3 = (int8_t)coeff_array[BME68X_IDX_P3];
+    calib->par_p4 = (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P4_MSB], coeff_array[BME68X_IDX_P4_LSB]));
+    calib->par_p5 = (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P5_MSB], coeff_array[BME68X_IDX_P5_LSB]));
+    calib->par_p6 = (int8_t)(coeff_array[BME68X_IDX_P6]);
+    calib->par_p7 = (int8_t)(coeff_array[BME68X_IDX_P7]);
+    calib->par_p8 = (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P8_MSB], coeff_array[BME68X_IDX_P8_LSB]));
+    calib->par_p9 = (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_P9_MSB], coeff_array[BME68X_IDX_P9_LSB]));
+    calib->par_p10 = (uint8_t)(coeff_array[BME68X_IDX_P10]);
+}
+
+/* This internal API is used to decode the coefficients read from BME68X_REG_COEFF2 and BME68X_REG_COEFF3 */
+static void parse_calib_coeff23(const uint8_t *coeff_array, struct bme68x_calib_data *calib)
+{
+    /* Temperature related coefficients */
+    calib->par_t1 = (uint16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_T1_MSB], coeff_array[BME68X_IDX_T1_LSB]));
+
+    /* Humidity related coefficients */
+    calib->par_h1 =
+        (uint16_t)(((uint16_t)coeff_array[BME68X_IDX_H1_MSB] << 4) |
+                   (coeff_array[BME68X_IDX_H1_LSB] & BME68X_BIT_H1_DATA_MSK));
+    calib->par_h2 =
+        (uint16_t)(((uint16_t)coeff_array[BME68X_IDX_H2_MSB] << 4) | ((coeff_array[BME68X_IDX_H2_LSB]) >> 4));
+    calib->par_h3 = (int8_t)coeff_array[BME68X_IDX_H3];
+    calib->par_h4 = (int8_t)coeff_array[BME68X_IDX_H4];
+    calib->par_h5 = (int8_t)coeff_array[BME68X_IDX_H5];
+    calib->par_h6 = (uint8_t)coeff_array[BME68X_IDX_H6];
+    calib->par_h7 = (int8_t)coeff_array[BME68X_IDX_H7];
+
+    /* Gas heater related coefficients */
+    calib->par_gh1 = (int8_t)coeff_array[BME68X_IDX_GH1];
+    calib->par_gh2 = (int16_t)(BME68X_CONCAT_BYTES(coeff_array[BME68X_IDX_GH2_MSB], coeff_array[BME68X_IDX_GH2_LSB]));
+    calib->par_gh3 = (int8_t)coeff_array[BME68X_IDX_GH3];
+
+    /* Other coefficients */
+    calib->res_heat_range = ((coeff_array[BME68X_IDX_RES_HEAT_RANGE] & BME68X_RHRANGE_MSK) / 16);
+    calib->res_heat_val = (int8_t)coeff_array[BME68X_IDX_RES_HEAT_VAL];
+    calib->range_sw_err = ((int8_t)(coeff_array[BME68X_IDX_RANGE_SW_ERR] & BME68X_RSERROR_MSK)) / 16;
+}
+
+/* This internal API is used to compare the coefficients decoded by parse_calib_coeff23 */
+static int8_t calib_coeff23_equal(const struct bme68x_calib_data *a, const struct bme68x_calib_data *b)
+{
+    return (a->par_t1 == b->par_t1) && (a->par_h1 == b->par_h1) && (a->par_h2 == b->par_h2) &&
+           (a->par_h3 == b->par_h3) && (a->par_h4 == b->par_h4) && (a->par_h5 == b->par_h5) &&
+           (a->par_h6 == b->par_h6) && (a->par_h7 == b->par_h7) && (a->par_gh1 == b->par_gh1) &&
+           (a->par_gh2 == b->par_gh2) && (a->par_gh3 == b->par_gh3) &&
+           (a->res_heat_range == b->res_heat_range) && (a->res_heat_val == b->res_heat_val) &&
+           (a->range_sw_err == b->range_sw_err);
+}
+
 /* This internal API is used to read variant ID information from the register */
 static int8_t read_variant_id(struct bme68x_dev *dev)
 {
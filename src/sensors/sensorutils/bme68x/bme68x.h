@@ -76,6 +76,27 @@ extern "C" {
  */
 int8_t bme68x_init(struct bme68x_dev *dev);
 
+/*!
+ * \ingroup bme68xApiInit
+ * \page bme68x_api_bme68x_init_with_calib bme68x_init_with_calib
+ * \code
+ * int8_t bme68x_init_with_calib(struct bme68x_dev *dev);
+ * \endcode
+ * @details This API verifies the chip-id like bme68x_init, but uses the variant ID
+ * and calibration coefficients the caller has already restored into dev (e.g. from
+ * non-volatile storage) instead of reading them from the sensor. The variant ID
+ * and the humidity, par_t1, gas and heater calibration blocks are read back and
+ * compared; on a mismatch the full calibration is read from the sensor.
+ *
+ * @param[in,out] dev : Structure instance of bme68x_dev with variant_id and calib set
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success, stored calibration used
+ * @retval BME68X_W_CALIB_RELOADED -> Stored calibration did not match and was read again
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_init_with_calib(struct bme68x_dev *dev);
+
 /**
  * \ingroup bme68x
  * \defgroup bme68xApiRegister Registers
@@ -225,6 +246,27 @@ uint32_t bme68x_get_meas_dur(const uint8_t op_mode, struct bme68x_conf *conf, st
  */
 int8_t bme68x_get_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_data, struct bme68x_dev *dev);
 
+/*!
+ * \ingroup bme68xApiData
+ * \page bme68x_api_bme68x_get_forced_data_burst bme68x_get_forced_data_burst
+ * \code
+ * int8_t bme68x_get_forced_data_burst(struct bme68x_data *data, struct bme68x_dev *dev);
+ * \endcode
+ * @details Forced-mode fast path: reads field 0 in a single burst and takes
+ * res_heat and gas_wait from the values cached when the heater was configured,
+ * instead of reading them back. Does not retry; returns BME68X_W_NO_NEW_DATA
+ * when the measurement has not completed yet so the caller can poll again.
+ *
+ * @param[out] data    : Structure instance to hold the data.
+ * @param[in,out] dev  : Structure instance of bme68x_dev
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval > 0 -> Warning
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_get_forced_data_burst(struct bme68x_data *data, struct bme68x_dev *dev);
+
 /**
  * \ingroup bme68x
  * \defgroup bme68xApiConfig Configuration
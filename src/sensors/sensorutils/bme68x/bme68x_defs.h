@@ -142,6 +142,9 @@
 /* Define the shared heating duration */
 #define BME68X_W_DEFINE_SHD_HEATR_DUR             INT8_C(3)
 
+/* Stored calibration did not match the sensor and was read again */
+#define BME68X_W_CALIB_RELOADED                   INT8_C(4)
+
 /* Information - only available via bme68x_dev.info_msg */
 #define BME68X_I_PARAM_CORR                       UINT8_C(1)
 
@@ -966,6 +969,15 @@ struct bme68x_dev
 
     /*! Store the info messages */
     uint8_t info_msg;
+
+    /*! Heater resistance registers as last written by bme68x_set_heatr_conf */
+    uint8_t res_heat_shadow[10];
+
+    /*! Gas wait registers as last written by bme68x_set_heatr_conf */
+    uint8_t gas_wait_shadow[10];
+
+    /*! Number of valid heater shadow entries, 0 after reset */
+    uint8_t heatr_shadow_len;
 };
 
 #endif /* BME68X_DEFS_H_ */
@@ -0,0 +1,32 @@
+#include "boot_timeline.h"
+#include "pico/stdlib.h"
+
+static volatile uint32_t reached_ms[BOOT_MILESTONE_COUNT];
+
+static const char *const names[BOOT_MILESTONE_COUNT] = {
+    [BOOT_RADIO_UP]     = "radio up",
+    [BOOT_ADVERTISING]  = "advertising",
+    [BOOT_SENSORS_UP]   = "sensors up",
+    [BOOT_FIRST_SAMPLE] = "first sample",
+    [BOOT_FIRST_VALID]  = "first valid sample",
+};
+
+void boot_mark(boot_milestone_t milestone) {
+    if (reached_ms[milestone] == 0) {
+        // nothing happens in the first millisecond, 0 can mean "not yet"
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        reached_ms[milestone] = now ? now : 1;
+    }
+}
+
+bool boot_reached(boot_milestone_t milestone) {
+    return reached_ms[milestone] != 0;
+}
+
+uint32_t boot_milestone_ms(boot_milestone_t milestone) {
+    return reached_ms[milestone];
+}
+
+const char *boot_milestone_name(boot_milestone_t milestone) {
+    return names[milestone];
+}
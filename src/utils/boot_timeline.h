@@ -0,0 +1,30 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Time since power-on at which each boot stage was first reached, to
+// measure time to first advertisement and time to first valid data.
+
+typedef enum {
+    BOOT_RADIO_UP,          // CYW43 initialised
+    BOOT_ADVERTISING,       // first BLE advertisement enabled
+    BOOT_SENSORS_UP,        // all sensor drivers initialised
+    BOOT_FIRST_SAMPLE,      // first sample published, warming or not
+    BOOT_FIRST_VALID,       // first sample with every sensor past warm-up
+    BOOT_MILESTONE_COUNT
+} boot_milestone_t;
+
+// records the current time unless the milestone was already reached;
+// safe from interrupt handlers and either core
+void boot_mark(boot_milestone_t milestone);
+
+bool boot_reached(boot_milestone_t milestone);
+
+// ms since boot, 0 if the milestone has not been reached
+uint32_t boot_milestone_ms(boot_milestone_t milestone);
+
+const char *boot_milestone_name(boot_milestone_t milestone);
+
+#endif //BOOT_TIMELINE_H
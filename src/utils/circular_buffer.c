@@ -3,3 +3,43 @@
 //
 
 #include "circular_buffer.h"
+#include <string.h>
+
+void circular_buffer_init(circular_buffer_t *cb, void *storage, uint32_t elem_size, uint32_t capacity) {
+    cb->storage = storage;
+    cb->elem_size = elem_size;
+    cb->mask = capacity - 1;
+    cb->head = 0;
+    cb->tail = 0;
+}
+
+bool circular_buffer_push(circular_buffer_t *cb, const void *elem) {
+    uint32_t head = cb->head;
+    // acquire pairs with the consumer's release, the slot is free once tail has moved past it
+    uint32_t tail = __atomic_load_n(&cb->tail, __ATOMIC_ACQUIRE);
+    if (head - tail > cb->mask) {
+        return false;
+    }
+
+    memcpy(cb->storage + (head & cb->mask) * cb->elem_size, elem, cb->elem_size);
+    // publish the element only after its bytes are written
+    __atomic_store_n(&cb->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool circular_buffer_pop(circular_buffer_t *cb, void *elem) {
+    uint32_t tail = cb->tail;
+    uint32_t head = __atomic_load_n(&cb->head, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return false;
+    }
+
+    memcpy(elem, cb->storage + (tail & cb->mask) * cb->elem_size, cb->elem_size);
+    // hand the slot back only after it has been copied out
+    __atomic_store_n(&cb->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint32_t circular_buffer_count(const circular_buffer_t *cb) {
+    return __atomic_load_n(&cb->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&cb->tail, __ATOMIC_ACQUIRE);
+}
@@ -5,4 +5,32 @@
 #ifndef CIRCULAR_BUFFER_H
 #define CIRCULAR_BUFFER_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+// Lock-free single-producer/single-consumer ring of fixed-size elements.
+// One side may only push and the other only pop; that is what makes it safe
+// between the two RP2040 cores (or two host threads) without a spin lock.
+// head and tail run freely and are masked on access, so all capacity
+// slots are usable.
+typedef struct {
+    uint8_t *storage;
+    uint32_t elem_size;
+    uint32_t mask;          // capacity - 1, capacity is a power of two
+    uint32_t head;          // next slot to write, only the producer stores it
+    uint32_t tail;          // next slot to read, only the consumer stores it
+} circular_buffer_t;
+
+// storage must hold capacity * elem_size bytes
+void circular_buffer_init(circular_buffer_t *cb, void *storage, uint32_t elem_size, uint32_t capacity);
+
+// producer side, returns false when the ring is full
+bool circular_buffer_push(circular_buffer_t *cb, const void *elem);
+
+// consumer side, returns false when the ring is empty
+bool circular_buffer_pop(circular_buffer_t *cb, void *elem);
+
+// elements waiting, exact on the consumer side and a lower bound elsewhere
+uint32_t circular_buffer_count(const circular_buffer_t *cb);
+
 #endif //CIRCULAR_BUFFER_H
@@ -0,0 +1,65 @@
+#include "event_loop.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+static spin_lock_t *lock;
+static volatile uint32_t pending;
+
+// only touched by the core running the loop
+static uint32_t window_start_us;
+static uint32_t idle_us;
+static uint32_t wakeups;
+static uint32_t dispatches;
+
+void event_loop_init(void) {
+    lock = spin_lock_instance(spin_lock_claim_unused(true));
+    pending = 0;
+    window_start_us = time_us_32();
+}
+
+void event_post(uint32_t events) {
+    uint32_t save = spin_lock_blocking(lock);
+    pending |= events;
+    spin_unlock(lock, save);
+    // sets the event register, so a post that races with event_wait's
+    // empty check still makes the following __wfe return at once
+    __sev();
+}
+
+uint32_t event_wait(void) {
+    while (true) {
+        uint32_t save = spin_lock_blocking(lock);
+        uint32_t events = pending;
+        pending = 0;
+        spin_unlock(lock, save);
+
+        if (events) {
+            dispatches++;
+            return events;
+        }
+
+        uint32_t start = time_us_32();
+        __wfe();
+        idle_us += time_us_32() - start;
+        wakeups++;
+    }
+}
+
+void event_loop_take_stats(event_loop_stats_t *stats) {
+    uint32_t now = time_us_32();
+    uint32_t window_us = now - window_start_us;
+    if (window_us == 0) {
+        window_us = 1;
+    }
+
+    stats->window_ms = window_us / 1000;
+    stats->idle_permille = (uint32_t) (((uint64_t) idle_us * 1000) / window_us);
+    stats->wakeups = wakeups;
+    stats->wakeups_per_sec = (uint32_t) (((uint64_t) wakeups * 1000000) / window_us);
+    stats->dispatches = dispatches;
+
+    window_start_us = now;
+    idle_us = 0;
+    wakeups = 0;
+    dispatches = 0;
+}
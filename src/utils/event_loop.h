@@ -0,0 +1,39 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+
+// Pending-event set for the core0 main loop. Interrupt handlers, alarm
+// callbacks, btstack handlers and core1 post events; the main loop takes
+// the whole set at once and sleeps in __wfe() while it is empty, so the
+// loop only runs when there is something to do.
+
+typedef enum {
+    EVENT_SAMPLE        = 1u << 0,  // core1 pushed a sample
+    EVENT_STATIONARY    = 1u << 1,  // LIS3DH inactivity interrupt
+    EVENT_MOTION        = 1u << 2,  // movement while asleep
+    EVENT_WAKE_TIMER    = 1u << 3,  // RTC full wake for a sensor check
+    EVENT_BLE           = 1u << 4,  // BLE connection state changed
+    EVENT_WORK          = 1u << 5,  // interrupt work deferred to the loop
+} event_t;
+
+typedef struct {
+    uint32_t window_ms;         // length of the measurement window
+    uint32_t idle_permille;     // share of the window spent in __wfe
+    uint32_t wakeups;           // returns from __wfe, including spurious ones
+    uint32_t wakeups_per_sec;
+    uint32_t dispatches;        // times the loop got at least one event
+} event_loop_stats_t;
+
+void event_loop_init(void);
+
+// safe from interrupt handlers and from either core
+void event_post(uint32_t events);
+
+// returns the posted events and clears them, sleeps until at least one arrives
+uint32_t event_wait(void);
+
+// statistics since the previous call, then starts a new window
+void event_loop_take_stats(event_loop_stats_t *stats);
+
+#endif //EVENT_LOOP_H
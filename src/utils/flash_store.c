@@ -0,0 +1,99 @@
+#include "flash_store.h"
+#include <string.h>
+#include "hardware/flash.h"
+#include "pico/flash.h"
+
+#define FLASH_STORE_MAGIC   0x52545346u  // "FSTR"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t key;
+    uint32_t len;
+    uint32_t crc;               // over key, len and payload
+} flash_store_header_t;
+
+_Static_assert(sizeof(flash_store_header_t) + FLASH_STORE_MAX_LEN == FLASH_PAGE_SIZE,
+               "record must fit into one flash page");
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1u));
+        }
+    }
+    return crc;
+}
+
+static uint32_t record_crc(uint32_t key, const void *payload, size_t len) {
+    uint32_t len32 = len;
+    uint32_t crc = 0xFFFFFFFFu;
+    crc = crc32_update(crc, (const uint8_t *) &key, sizeof(key));
+    crc = crc32_update(crc, (const uint8_t *) &len32, sizeof(len32));
+    crc = crc32_update(crc, payload, len);
+    return ~crc;
+}
+
+typedef struct {
+    uint32_t offset;
+    const uint8_t *page;
+} flash_store_write_t;
+
+// called by flash_safe_execute() with interrupts off and the other core paused
+static void write_sector(void *param) {
+    const flash_store_write_t *write = param;
+    flash_range_erase(write->offset, FLASH_SECTOR_SIZE);
+    flash_range_program(write->offset, write->page, FLASH_PAGE_SIZE);
+}
+
+// flash is memory mapped through XIP, reading needs no special handling
+static const flash_store_header_t *stored_header(uint32_t offset) {
+    return (const flash_store_header_t *) (uintptr_t) (XIP_BASE + offset);
+}
+
+bool flash_store_load(uint32_t offset, uint32_t key, void *dst, size_t len) {
+    const flash_store_header_t *header = stored_header(offset);
+    if (len > FLASH_STORE_MAX_LEN || header->magic != FLASH_STORE_MAGIC ||
+        header->key != key || header->len != len) {
+        return false;
+    }
+
+    const uint8_t *payload = (const uint8_t *) (header + 1);
+    if (record_crc(key, payload, len) != header->crc) {
+        return false;
+    }
+    memcpy(dst, payload, len);
+    return true;
+}
+
+bool flash_store_save(uint32_t offset, uint32_t key, const void *src, size_t len) {
+    if (len > FLASH_STORE_MAX_LEN) {
+        return false;
+    }
+
+    // avoid wearing the sector when nothing changed
+    uint8_t page[FLASH_PAGE_SIZE];
+    if (flash_store_load(offset, key, page, len) && memcmp(page, src, len) == 0) {
+        return true;
+    }
+
+    memset(page, 0xFF, sizeof(page));
+    flash_store_header_t header = {
+        .magic = FLASH_STORE_MAGIC,
+        .key = key,
+        .len = len,
+        .crc = record_crc(key, src, len),
+    };
+    memcpy(page, &header, sizeof(header));
+    memcpy(page + sizeof(header), src, len);
+
+    // the cyw43 and BTstack may already be running, the SDK coordinates the
+    // lockout the same way as for the BTstack bond store
+    flash_store_write_t write = { .offset = offset, .page = page };
+    if (flash_safe_execute(write_sector, &write, FLASH_STORE_TIMEOUT_MS) != PICO_OK) {
+        return false;
+    }
+
+    // read back through XIP to confirm the program succeeded
+    return flash_store_load(offset, key, page, len) && memcmp(page, src, len) == 0;
+}
@@ -0,0 +1,26 @@
+#ifndef FLASH_STORE_H
+#define FLASH_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// A single keyed record at the start of a dedicated flash sector, checked
+// with a CRC-32. Used for data that is expensive to re-read from a device
+// on every boot. The payload has to fit into one flash page with the header.
+#define FLASH_STORE_MAX_LEN     (256 - 16)
+
+// longest wait for the other core to pause, see flash_safe_execute()
+#define FLASH_STORE_TIMEOUT_MS  100
+
+// offset is relative to the start of flash and must be sector aligned.
+// Returns true and fills dst when the sector holds a valid record with the
+// same key and length.
+bool flash_store_load(uint32_t offset, uint32_t key, void *dst, size_t len);
+
+// Erases the sector and writes a new record unless an identical record is
+// already stored. Goes through flash_safe_execute(), so a running second core
+// must have called flash_safe_execute_core_init(); false if it did not pause.
+bool flash_store_save(uint32_t offset, uint32_t key, const void *src, size_t len);
+
+#endif //FLASH_STORE_H
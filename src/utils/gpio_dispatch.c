@@ -0,0 +1,42 @@
+#include "gpio_dispatch.h"
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+
+static gpio_irq_callback_t handlers[NUM_BANK0_GPIOS];
+static isr_timing_t timing[NUM_BANK0_GPIOS];
+static bool installed;
+
+static void dispatch(uint gpio, uint32_t events) {
+    uint32_t start = time_us_32();
+    gpio_irq_callback_t handler = handlers[gpio];
+    if (handler) {
+        handler(gpio, events);
+        isr_timing_record(&timing[gpio], start, time_us_32());
+    }
+}
+
+void gpio_dispatch_add(uint gpio, uint32_t event_mask, gpio_irq_callback_t handler) {
+    handlers[gpio] = handler;
+    timing[gpio] = (isr_timing_t) {0};
+    if (!installed) {
+        // the SDK keeps one callback per core for the whole bank
+        gpio_set_irq_callback(dispatch);
+        irq_set_enabled(IO_IRQ_BANK0, true);
+        installed = true;
+    }
+    gpio_set_irq_enabled(gpio, event_mask, true);
+}
+
+void gpio_dispatch_remove(uint gpio) {
+    gpio_set_irq_enabled(gpio, GPIO_IRQ_LEVEL_LOW | GPIO_IRQ_LEVEL_HIGH |
+                         GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, false);
+    handlers[gpio] = NULL;
+}
+
+bool gpio_dispatch_get_timing(uint gpio, isr_timing_t *out) {
+    if (!handlers[gpio]) {
+        return false;
+    }
+    *out = timing[gpio];
+    return true;
+}
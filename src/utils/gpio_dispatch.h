@@ -0,0 +1,21 @@
+#ifndef GPIO_DISPATCH_H
+#define GPIO_DISPATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/gpio.h"
+#include "work_queue.h"
+
+// Per-pin GPIO interrupt handlers behind the SDK's single bank callback.
+// Each pin gets its own handler and execution time statistics; handlers
+// run in interrupt context and should only defer work.
+
+// installs handler for gpio and enables the given edge/level events
+void gpio_dispatch_add(uint gpio, uint32_t event_mask, gpio_irq_callback_t handler);
+
+void gpio_dispatch_remove(uint gpio);
+
+// false if no handler is installed for gpio
+bool gpio_dispatch_get_timing(uint gpio, isr_timing_t *timing);
+
+#endif //GPIO_DISPATCH_H
@@ -0,0 +1,359 @@
+#include "i2c_dma.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#define BUS_CLEAR_HALF_PERIOD_US    5   //100 kHz, slow enough for any slave
+#define IRQ_SPIN_LIMIT_US           50  //a STOP or the last RX byte, ~20 us at 100 kHz
+
+typedef struct {
+    i2c_inst_t *i2c;
+    uint baudrate;
+    uint sda_pin;
+    uint scl_pin;
+    uint tx_chan;
+    uint rx_chan;
+    dma_channel_config tx_cfg;
+    dma_channel_config rx_cfg;
+
+    i2c_dma_txn_t *volatile current;
+    uint64_t deadline_us;
+    i2c_dma_txn_t *head[I2C_DMA_PRIO_COUNT];
+    i2c_dma_txn_t *tail[I2C_DMA_PRIO_COUNT];
+
+    i2c_dma_stats_t stats;
+    uint16_t cmd[I2C_DMA_MAX_LEN];  // IC_DATA_CMD words: data or read command plus RESTART/STOP
+} i2c_dma_bus_t;
+
+static i2c_dma_bus_t buses[2];
+static i2c_dma_device_t *devices;
+
+static inline i2c_dma_bus_t *bus_of(i2c_inst_t *i2c) {
+    return &buses[i2c_hw_index(i2c)];
+}
+
+static void setup_controller(i2c_dma_bus_t *bus) {
+    // i2c_init also enables the controller's DMA handshake
+    i2c_init(bus->i2c, bus->baudrate);
+    gpio_set_function(bus->sda_pin, GPIO_FUNC_I2C);
+    gpio_set_function(bus->scl_pin, GPIO_FUNC_I2C);
+    gpio_pull_up(bus->sda_pin);
+    gpio_pull_up(bus->scl_pin);
+    i2c_get_hw(bus->i2c)->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+}
+
+// a slave holding SDA low mid-byte lets go once it has clocked out the rest
+// of its byte; the lines are driven open-drain by switching the pin direction
+static void bus_clear(i2c_dma_bus_t *bus) {
+    i2c_get_hw(bus->i2c)->enable = 0;
+    gpio_set_function(bus->sda_pin, GPIO_FUNC_SIO);
+    gpio_set_function(bus->scl_pin, GPIO_FUNC_SIO);
+    gpio_put(bus->sda_pin, 0);
+    gpio_put(bus->scl_pin, 0);
+    gpio_set_dir(bus->sda_pin, GPIO_IN);
+    gpio_set_dir(bus->scl_pin, GPIO_IN);
+
+    for (int i = 0; i < 9 && !gpio_get(bus->sda_pin); i++) {
+        gpio_set_dir(bus->scl_pin, GPIO_OUT);
+        busy_wait_us_32(BUS_CLEAR_HALF_PERIOD_US);
+        gpio_set_dir(bus->scl_pin, GPIO_IN);
+        busy_wait_us_32(BUS_CLEAR_HALF_PERIOD_US);
+    }
+
+    // STOP: SDA rises while SCL is high
+    gpio_set_dir(bus->sda_pin, GPIO_OUT);
+    busy_wait_us_32(BUS_CLEAR_HALF_PERIOD_US);
+    gpio_set_dir(bus->sda_pin, GPIO_IN);
+    busy_wait_us_32(BUS_CLEAR_HALF_PERIOD_US);
+
+    setup_controller(bus);
+    bus->stats.recoveries++;
+}
+
+static inline uint latency_bucket(uint32_t us) {
+    uint32_t scaled = us >> 6;
+    uint b = scaled ? 32 - __builtin_clz(scaled) : 0;
+    return b < I2C_DMA_LAT_BUCKETS ? b : I2C_DMA_LAT_BUCKETS - 1;
+}
+
+// highest priority queued transfer onto the bus; interrupts are off or this is the bus interrupt
+static void start_next(i2c_dma_bus_t *bus) {
+    i2c_dma_txn_t *txn = NULL;
+    for (int p = 0; p < I2C_DMA_PRIO_COUNT && !txn; p++) {
+        txn = bus->head[p];
+        if (txn) {
+            bus->head[p] = txn->next;
+        }
+    }
+    bus->current = txn;
+    if (!txn) {
+        return;
+    }
+
+    size_t n = txn->wlen + txn->rlen;
+    for (size_t i = 0; i < txn->wlen; i++) {
+        bus->cmd[i] = txn->src[i];
+    }
+    for (size_t i = 0; i < txn->rlen; i++) {
+        bus->cmd[txn->wlen + i] = I2C_IC_DATA_CMD_CMD_BITS;
+    }
+    if (txn->wlen && txn->rlen) {
+        bus->cmd[txn->wlen] |= I2C_IC_DATA_CMD_RESTART_BITS;
+    }
+    bus->cmd[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    // the target address can only change while the controller is disabled
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+    hw->enable = 0;
+    hw->tar = txn->dev->addr;
+    hw->enable = 1;
+    (void) hw->clr_intr;
+
+    bus->deadline_us = time_us_64() + txn->dev->timeout_us;
+    if (txn->rlen) {
+        dma_channel_configure(bus->rx_chan, &bus->rx_cfg, txn->dst, &hw->data_cmd, txn->rlen, true);
+    }
+    dma_channel_configure(bus->tx_chan, &bus->tx_cfg, &hw->data_cmd, bus->cmd, n, true);
+}
+
+static void complete(i2c_dma_bus_t *bus, int result) {
+    i2c_dma_txn_t *txn = bus->current;
+    i2c_dma_device_stats_t *dev_stats = &txn->dev->stats;
+
+    uint32_t latency = time_us_32() - txn->submit_us;
+    dev_stats->transfers++;
+    dev_stats->latency_hist[latency_bucket(latency)]++;
+    if (latency > dev_stats->max_latency_us) {
+        dev_stats->max_latency_us = latency;
+    }
+    if (result == PICO_ERROR_TIMEOUT) {
+        dev_stats->timeouts++;
+    } else if (result < 0) {
+        dev_stats->errors++;
+    }
+
+    // keep the bus busy before handing the result back
+    start_next(bus);
+    if (txn->callback) {
+        txn->callback(result, txn->user_data);
+    }
+    __sev(); // blocking callers may be waiting on either core
+}
+
+static void abort_dma(i2c_dma_bus_t *bus) {
+    dma_channel_abort(bus->tx_chan);
+    dma_channel_abort(bus->rx_chan);
+}
+
+// the interrupt only waits for the tail of a transfer, a slave stretching
+// SCL forever must not hang it
+static inline bool spin_expired(uint32_t start) {
+    return time_us_32() - start >= IRQ_SPIN_LIMIT_US;
+}
+
+static void bus_irq(i2c_dma_bus_t *bus) {
+    uint32_t start = time_us_32();
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+    uint32_t stat = hw->intr_stat;
+    i2c_dma_txn_t *txn = bus->current;
+
+    int result = 0;
+    if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        uint32_t source = hw->tx_abrt_source;
+        abort_dma(bus);
+        // the controller issues a STOP after an abort, let it finish so its
+        // STOP_DET cannot complete the next transfer
+        while ((hw->status & I2C_IC_STATUS_ACTIVITY_BITS) && !spin_expired(start)) {
+            tight_loop_contents();
+        }
+        bool stopped = !(hw->status & I2C_IC_STATUS_ACTIVITY_BITS);
+        (void) hw->clr_tx_abrt;
+        if (!stopped || (source & I2C_IC_TX_ABRT_SOURCE_ARB_LOST_BITS)) {
+            bus_clear(bus); // another master or a slave holding SDA or SCL low
+        }
+        bus->stats.errors++;
+        result = PICO_ERROR_GENERIC;
+    } else if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        // the last byte may still be on its way out of the RX FIFO
+        while (txn && txn->rlen && dma_channel_is_busy(bus->rx_chan) && !spin_expired(start)) {
+            tight_loop_contents();
+        }
+        if (txn && txn->rlen && dma_channel_is_busy(bus->rx_chan)) {
+            abort_dma(bus);
+            bus->stats.errors++;
+            result = PICO_ERROR_GENERIC;
+        } else if (txn) {
+            bus->stats.transfers++;
+            bus->stats.bytes += txn->wlen + txn->rlen;
+            result = (int) (txn->rlen ? txn->rlen : txn->wlen);
+        }
+    } else {
+        return;
+    }
+    (void) hw->clr_stop_det;
+
+    if (!txn) {
+        return;
+    }
+    complete(bus, result);
+    bus->stats.cpu_us += time_us_32() - start;
+}
+
+static void i2c0_irq_handler(void) {
+    bus_irq(&buses[0]);
+}
+
+static void i2c1_irq_handler(void) {
+    bus_irq(&buses[1]);
+}
+
+static inline uint bus_irq_num(uint index) {
+    return index ? I2C1_IRQ : I2C0_IRQ;
+}
+
+void i2c_dma_init(i2c_inst_t *i2c, uint baudrate, uint sda_pin, uint scl_pin) {
+    uint index = i2c_hw_index(i2c);
+    i2c_dma_bus_t *bus = &buses[index];
+    bus->i2c = i2c;
+    bus->baudrate = baudrate;
+    bus->sda_pin = sda_pin;
+    bus->scl_pin = scl_pin;
+    bus->current = NULL;
+    for (int p = 0; p < I2C_DMA_PRIO_COUNT; p++) {
+        bus->head[p] = NULL;
+    }
+
+    bus->tx_chan = dma_claim_unused_channel(true);
+    bus->tx_cfg = dma_channel_get_default_config(bus->tx_chan);
+    channel_config_set_transfer_data_size(&bus->tx_cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&bus->tx_cfg, true);
+    channel_config_set_write_increment(&bus->tx_cfg, false);
+    channel_config_set_dreq(&bus->tx_cfg, i2c_get_dreq(i2c, true));
+
+    bus->rx_chan = dma_claim_unused_channel(true);
+    bus->rx_cfg = dma_channel_get_default_config(bus->rx_chan);
+    channel_config_set_transfer_data_size(&bus->rx_cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&bus->rx_cfg, false);
+    channel_config_set_write_increment(&bus->rx_cfg, true);
+    channel_config_set_dreq(&bus->rx_cfg, i2c_get_dreq(i2c, false));
+
+    setup_controller(bus);
+    irq_set_exclusive_handler(bus_irq_num(index), index ? i2c1_irq_handler : i2c0_irq_handler);
+    irq_set_enabled(bus_irq_num(index), true);
+}
+
+void i2c_dma_irq_enable(bool enable) {
+    for (uint index = 0; index < 2; index++) {
+        if (buses[index].i2c) {
+            irq_set_enabled(bus_irq_num(index), enable);
+        }
+    }
+}
+
+void i2c_dma_device_init(i2c_dma_device_t *dev, i2c_inst_t *i2c, uint8_t addr,
+                         i2c_dma_priority_t priority, uint32_t timeout_us, const char *name) {
+    dev->i2c = i2c;
+    dev->addr = addr;
+    dev->priority = priority;
+    dev->timeout_us = timeout_us;
+    dev->name = name;
+    dev->stats = (i2c_dma_device_stats_t) {0};
+
+    // a driver that is initialised again keeps its place in the list
+    for (const i2c_dma_device_t *d = devices; d; d = d->next) {
+        if (d == dev) {
+            return;
+        }
+    }
+    dev->next = devices;
+    devices = dev;
+}
+
+bool i2c_dma_submit(i2c_dma_txn_t *txn) {
+    size_t n = txn->wlen + txn->rlen;
+    if (n == 0 || n > I2C_DMA_MAX_LEN) {
+        return false;
+    }
+    i2c_dma_bus_t *bus = bus_of(txn->dev->i2c);
+    uint32_t start = time_us_32();
+    txn->submit_us = start;
+    txn->next = NULL;
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    i2c_dma_priority_t p = txn->dev->priority;
+    if (bus->head[p]) {
+        bus->tail[p]->next = txn;
+    } else {
+        bus->head[p] = txn;
+    }
+    bus->tail[p] = txn;
+    if (!bus->current) {
+        start_next(bus);
+    }
+    restore_interrupts(irq_state);
+
+    bus->stats.cpu_us += time_us_32() - start;
+    return true;
+}
+
+typedef struct {
+    volatile bool done;
+    volatile int result;
+} blocking_wait_t;
+
+static void blocking_done(int result, void *user_data) {
+    blocking_wait_t *wait = user_data;
+    wait->result = result;
+    wait->done = true;
+}
+
+int i2c_dma_transfer_blocking(i2c_dma_device_t *dev, const uint8_t *src, size_t wlen,
+                              uint8_t *dst, size_t rlen) {
+    i2c_dma_bus_t *bus = bus_of(dev->i2c);
+    blocking_wait_t wait = { .done = false, .result = PICO_ERROR_GENERIC };
+    i2c_dma_txn_t txn = {
+        .dev = dev, .src = src, .wlen = wlen, .dst = dst, .rlen = rlen,
+        .callback = blocking_done, .user_data = &wait
+    };
+    uint32_t start = time_us_32();
+
+    if (!i2c_dma_submit(&txn)) {
+        return PICO_ERROR_GENERIC;
+    }
+    // transfers queued ahead of this one each get their own timeout
+    while (!wait.done) {
+        i2c_dma_poll(dev->i2c);
+        if (!wait.done) {
+            best_effort_wfe_or_timeout(from_us_since_boot(bus->deadline_us));
+        }
+    }
+
+    bus->stats.wait_us += time_us_32() - start;
+    return wait.result;
+}
+
+void i2c_dma_poll(i2c_inst_t *i2c) {
+    i2c_dma_bus_t *bus = bus_of(i2c);
+    uint32_t irq_state = save_and_disable_interrupts();
+    if (bus->current && time_us_64() >= bus->deadline_us) {
+        abort_dma(bus);
+        bus_clear(bus);
+        bus->stats.timeouts++;
+        complete(bus, PICO_ERROR_TIMEOUT);
+    }
+    restore_interrupts(irq_state);
+}
+
+bool i2c_dma_busy(i2c_inst_t *i2c) {
+    return bus_of(i2c)->current != NULL;
+}
+
+void i2c_dma_get_stats(i2c_inst_t *i2c, i2c_dma_stats_t *stats) {
+    *stats = bus_of(i2c)->stats;
+}
+
+const i2c_dma_device_t *i2c_dma_next_device(const i2c_dma_device_t *prev) {
+    return prev ? prev->next : devices;
+}
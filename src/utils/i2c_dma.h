@@ -0,0 +1,108 @@
+#ifndef I2C_DMA_H
+#define I2C_DMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hardware/i2c.h"
+
+// DMA-driven I2C transfers. Each bus gets a TX channel feeding the
+// controller's command FIFO and an RX channel draining its data FIFO; the
+// controller's STOP_DET / TX_ABRT interrupt completes the transfer, so the
+// CPU is free for the whole transaction. The two buses run independently,
+// a transfer on i2c1 can overlap one on i2c0.
+//
+// Transfers are queued per bus by device priority; the next one starts from
+// the completion interrupt of the last. A transfer that outlives its device's
+// timeout is aborted and the bus is cleared (9 SCL pulses, STOP, controller
+// re-init), so a stuck slave costs one timeout instead of hanging the firmware.
+// All transfers on a bus must be issued from the core that handles its interrupt.
+
+#define I2C_DMA_MAX_LEN         256     //bytes written + read per transfer
+#define I2C_DMA_LAT_BUCKETS     8       //bucket b counts latencies below 64 << b us, the last is open-ended
+
+typedef enum {
+    I2C_DMA_PRIO_HIGH,      // latency sensitive, e.g. accelerometer reads
+    I2C_DMA_PRIO_NORMAL,
+    I2C_DMA_PRIO_LOW,       // bulk reads that can wait
+    I2C_DMA_PRIO_COUNT
+} i2c_dma_priority_t;
+
+// result is the number of bytes read (or written for write-only transfers),
+// or a negative PICO_ERROR code; called from the bus interrupt
+typedef void (*i2c_dma_callback_t)(int result, void *user_data);
+
+typedef struct {
+    uint32_t transfers;     // completed transfers
+    uint32_t errors;        // transfers ended by an abort (NACK, arbitration loss)
+    uint32_t timeouts;      // transfers aborted after the device timeout
+    uint32_t recoveries;    // bus clears
+    uint32_t bytes;         // payload bytes moved
+    uint32_t cpu_us;        // CPU time setting up transfers and in the completion interrupt
+    uint32_t wait_us;       // time blocking callers slept in __wfe while the DMA ran
+} i2c_dma_stats_t;
+
+typedef struct {
+    uint32_t transfers;
+    uint32_t errors;
+    uint32_t timeouts;
+    uint32_t max_latency_us;                    // submit to completion, queueing included
+    uint32_t latency_hist[I2C_DMA_LAT_BUCKETS];
+} i2c_dma_device_stats_t;
+
+typedef struct i2c_dma_device {
+    i2c_inst_t *i2c;
+    uint8_t addr;
+    i2c_dma_priority_t priority;
+    uint32_t timeout_us;    // from the start of the transfer on the bus
+    const char *name;
+    i2c_dma_device_stats_t stats;
+    struct i2c_dma_device *next;
+} i2c_dma_device_t;
+
+// one queued transfer; the storage belongs to the caller until the callback runs
+typedef struct i2c_dma_txn {
+    i2c_dma_device_t *dev;
+    const uint8_t *src;
+    size_t wlen;
+    uint8_t *dst;
+    size_t rlen;
+    i2c_dma_callback_t callback;
+    void *user_data;
+    uint32_t submit_us;
+    struct i2c_dma_txn *next;
+} i2c_dma_txn_t;
+
+// sets up the controller at baudrate on the given pins, claims two DMA
+// channels and enables the bus interrupt on the calling core
+void i2c_dma_init(i2c_inst_t *i2c, uint baudrate, uint sda_pin, uint scl_pin);
+
+// moves completion interrupts of all initialised buses to or from the calling
+// core; the core that issues transfers should be the one handling them
+void i2c_dma_irq_enable(bool enable);
+
+// registers a device on an initialised bus, it shows up in i2c_dma_next_device()
+void i2c_dma_device_init(i2c_dma_device_t *dev, i2c_inst_t *i2c, uint8_t addr,
+                         i2c_dma_priority_t priority, uint32_t timeout_us, const char *name);
+
+// queues txn: writes wlen bytes then, after a repeated start, reads rlen bytes;
+// either length may be zero. Returns false if the lengths are invalid.
+bool i2c_dma_submit(i2c_dma_txn_t *txn);
+
+// one transfer, waiting in __wfe for it and everything queued ahead of it;
+// returns the bytes transferred or a negative PICO_ERROR code
+int i2c_dma_transfer_blocking(i2c_dma_device_t *dev, const uint8_t *src, size_t wlen,
+                              uint8_t *dst, size_t rlen);
+
+// aborts the running transfer once it is past its timeout; called by blocking
+// waiters, and should be called periodically by code using i2c_dma_submit()
+void i2c_dma_poll(i2c_inst_t *i2c);
+
+bool i2c_dma_busy(i2c_inst_t *i2c);
+
+void i2c_dma_get_stats(i2c_inst_t *i2c, i2c_dma_stats_t *stats);
+
+// iterates over registered devices, pass NULL for the first
+const i2c_dma_device_t *i2c_dma_next_device(const i2c_dma_device_t *prev);
+
+#endif //I2C_DMA_H
@@ -0,0 +1,155 @@
+#include "reg_cache.h"
+#include <string.h>
+
+static inline bool bit_test(const uint32_t *map, uint8_t reg) {
+    return (map[reg >> 5] >> (reg & 31)) & 1u;
+}
+
+static inline void bit_set(uint32_t *map, uint8_t reg) {
+    map[reg >> 5] |= 1u << (reg & 31);
+}
+
+static inline bool is_cached(const reg_cache_t *cache, uint8_t reg) {
+    return bit_test(cache->cacheable, reg) && bit_test(cache->valid, reg);
+}
+
+static void store(reg_cache_t *cache, uint8_t reg, uint8_t value) {
+    if (bit_test(cache->cacheable, reg)) {
+        cache->value[reg] = value;
+        bit_set(cache->valid, reg);
+    }
+}
+
+void reg_cache_init(reg_cache_t *cache, i2c_dma_device_t *dev, uint8_t auto_increment) {
+    memset(cache, 0, sizeof(*cache));
+    cache->dev = dev;
+    cache->auto_increment = auto_increment;
+}
+
+void reg_cache_mark_cacheable(reg_cache_t *cache, uint8_t first, uint8_t last) {
+    for (uint32_t reg = first; reg <= last; reg++) {
+        bit_set(cache->cacheable, (uint8_t) reg);
+    }
+}
+
+void reg_cache_invalidate(reg_cache_t *cache) {
+    memset(cache->valid, 0, sizeof(cache->valid));
+    cache->stats.invalidations++;
+}
+
+static int bus_read(reg_cache_t *cache, uint8_t reg, uint8_t *dst, size_t len) {
+    uint8_t sub = reg;
+    if (len > 1) {
+        sub |= cache->auto_increment;
+    }
+
+    // sub-address write and data read go out as one repeated-start transfer
+    cache->stats.transactions++;
+    return i2c_dma_transfer_blocking(cache->dev, &sub, 1, dst, len);
+}
+
+int reg_cache_read(reg_cache_t *cache, uint8_t reg, uint8_t *dst, size_t len) {
+    bool hit = len > 0 && reg + len <= 256;
+    for (size_t i = 0; hit && i < len; i++) {
+        hit = is_cached(cache, (uint8_t) (reg + i));
+    }
+
+    if (hit) {
+        memcpy(dst, &cache->value[reg], len);
+        cache->stats.read_hits++;
+        return (int) len;
+    }
+    cache->stats.read_misses++;
+
+    int ret = bus_read(cache, reg, dst, len);
+    if (ret < 0) return ret;
+
+    for (size_t i = 0; i < len && reg + i < 256; i++) {
+        store(cache, (uint8_t) (reg + i), dst[i]);
+    }
+    return ret;
+}
+
+int reg_cache_read_stream(reg_cache_t *cache, uint8_t reg, uint8_t *dst, size_t len) {
+    cache->stats.read_misses++;
+    return bus_read(cache, reg, dst, len);
+}
+
+int reg_cache_write(reg_cache_t *cache, uint8_t reg, const uint8_t *src, size_t len) {
+    bool redundant = len > 0 && reg + len <= 256;
+    for (size_t i = 0; redundant && i < len; i++) {
+        uint8_t r = (uint8_t) (reg + i);
+        redundant = is_cached(cache, r) && cache->value[r] == src[i];
+    }
+
+    if (redundant) {
+        cache->stats.write_skips += len;
+        return (int) len;
+    }
+
+    uint8_t buf[len + 1];
+    buf[0] = len > 1 ? (reg | cache->auto_increment) : reg;
+    memcpy(buf + 1, src, len);
+
+    cache->stats.transactions++;
+    int ret = i2c_dma_transfer_blocking(cache->dev, buf, len + 1, NULL, 0);
+    if (ret < 0) {
+        // the device state is unknown now
+        reg_cache_invalidate(cache);
+        return ret;
+    }
+
+    cache->stats.writes += len;
+    for (size_t i = 0; i < len && reg + i < 256; i++) {
+        store(cache, (uint8_t) (reg + i), src[i]);
+    }
+    return (int) len;
+}
+
+int reg_cache_write_pairs(reg_cache_t *cache, const uint8_t *pairs, size_t n_pairs) {
+    uint8_t buf[n_pairs * 2];
+    size_t n_out = 0;
+
+    for (size_t i = 0; i < n_pairs; i++) {
+        uint8_t reg = pairs[2 * i];
+        uint8_t value = pairs[2 * i + 1];
+        if (is_cached(cache, reg) && cache->value[reg] == value) {
+            cache->stats.write_skips++;
+            continue;
+        }
+        buf[2 * n_out] = reg;
+        buf[2 * n_out + 1] = value;
+        n_out++;
+    }
+
+    if (n_out == 0) {
+        return 0;
+    }
+
+    cache->stats.transactions++;
+    int ret = i2c_dma_transfer_blocking(cache->dev, buf, n_out * 2, NULL, 0);
+    if (ret < 0) {
+        reg_cache_invalidate(cache);
+        return ret;
+    }
+
+    cache->stats.writes += n_out;
+    for (size_t i = 0; i < n_out; i++) {
+        store(cache, buf[2 * i], buf[2 * i + 1]);
+    }
+    return (int) n_out;
+}
+
+void reg_cache_update_bits(reg_cache_t *cache, uint8_t reg, uint8_t mask, uint8_t value) {
+    if (is_cached(cache, reg)) {
+        cache->value[reg] = (cache->value[reg] & ~mask) | (value & mask);
+    }
+}
+
+void reg_cache_get_stats(const reg_cache_t *cache, reg_cache_stats_t *stats) {
+    *stats = cache->stats;
+}
+
+void reg_cache_reset_stats(reg_cache_t *cache) {
+    memset(&cache->stats, 0, sizeof(cache->stats));
+}
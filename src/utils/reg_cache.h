@@ -0,0 +1,63 @@
+#ifndef REG_CACHE_H
+#define REG_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "i2c_dma.h"
+
+// Write-through shadow of an I2C sensor's configuration registers.
+// Writes that would not change a cached register are skipped and reads
+// of cached registers are served from RAM. Data and status registers are
+// never marked cacheable and always go to the bus, as transfers of the
+// driver's i2c_dma device.
+
+typedef struct {
+    uint32_t read_hits;
+    uint32_t read_misses;
+    uint32_t writes;            // register writes that went to the bus
+    uint32_t write_skips;       // register writes dropped as redundant
+    uint32_t transactions;      // I2C transactions issued, a register read is one write+read transfer
+    uint32_t invalidations;
+} reg_cache_stats_t;
+
+typedef struct {
+    i2c_dma_device_t *dev;
+    uint8_t auto_increment;     // OR'd into the sub-address for multi-byte reads
+    uint8_t value[256];
+    uint32_t cacheable[8];
+    uint32_t valid[8];
+    reg_cache_stats_t stats;
+} reg_cache_t;
+
+void reg_cache_init(reg_cache_t *cache, i2c_dma_device_t *dev, uint8_t auto_increment);
+
+// registers first..last (inclusive) hold configuration and may be cached
+void reg_cache_mark_cacheable(reg_cache_t *cache, uint8_t first, uint8_t last);
+
+// forget every cached value, e.g. after a soft reset
+void reg_cache_invalidate(reg_cache_t *cache);
+
+// reads len consecutive registers, returns len or a negative PICO_ERROR code
+int reg_cache_read(reg_cache_t *cache, uint8_t reg, uint8_t *dst, size_t len);
+
+// reads a burst that does not map onto consecutive registers, e.g. a FIFO
+// whose sub-address wraps; served from the bus and never cached
+int reg_cache_read_stream(reg_cache_t *cache, uint8_t reg, uint8_t *dst, size_t len);
+
+// writes len consecutive registers, returns len or a negative PICO_ERROR code
+int reg_cache_write(reg_cache_t *cache, uint8_t reg, const uint8_t *src, size_t len);
+
+// writes (register, value) pairs in one transfer, dropping pairs that are
+// already cached with the same value; returns the pairs written or a negative error
+int reg_cache_write_pairs(reg_cache_t *cache, const uint8_t *pairs, size_t n_pairs);
+
+// records a change the device made on its own (e.g. returning to sleep
+// after a forced measurement); only touches registers already cached
+void reg_cache_update_bits(reg_cache_t *cache, uint8_t reg, uint8_t mask, uint8_t value);
+
+void reg_cache_get_stats(const reg_cache_t *cache, reg_cache_stats_t *stats);
+
+void reg_cache_reset_stats(reg_cache_t *cache);
+
+#endif //REG_CACHE_H
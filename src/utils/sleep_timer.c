@@ -0,0 +1,111 @@
+#include "sleep_timer.h"
+#include "pico/stdlib.h"
+#include "hardware/timer.h"
+#include "hardware/sync.h"
+
+static spin_lock_t *lock;
+static uint alarm_num;
+static sleep_timer_t *head;     // sorted by deadline
+static isr_timing_t isr_timing;
+
+uint64_t sleep_timer_now_ms(void) {
+    return time_us_64() / 1000;
+}
+
+static void unlink(sleep_timer_t *timer) {
+    for (sleep_timer_t **p = &head; *p; p = &(*p)->next) {
+        if (*p == timer) {
+            *p = timer->next;
+            break;
+        }
+    }
+    timer->pending = false;
+}
+
+// hands expired timers to the work queue and arms the alarm for the new
+// head; a deadline that passes while arming is expired on the next round.
+// Called with the lock held.
+static void expire_and_arm(void) {
+    while (head) {
+        uint64_t now = sleep_timer_now_ms();
+        while (head && head->deadline_ms <= now) {
+            sleep_timer_t *timer = head;
+            head = timer->next;
+            timer->pending = false;
+            work_defer(timer->work_id, timer->arg);
+        }
+        if (!head) {
+            break;
+        }
+        // returns true if the target is already in the past
+        if (!hardware_alarm_set_target(alarm_num, from_us_since_boot(head->deadline_ms * 1000))) {
+            return;
+        }
+    }
+    hardware_alarm_cancel(alarm_num);
+}
+
+static void alarm_callback(uint num) {
+    uint32_t start = time_us_32();
+    uint32_t save = spin_lock_blocking(lock);
+    expire_and_arm();
+    spin_unlock(lock, save);
+    isr_timing_record(&isr_timing, start, time_us_32());
+}
+
+void sleep_timer_init(void) {
+    lock = spin_lock_instance(spin_lock_claim_unused(true));
+    alarm_num = (uint) hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm_num, alarm_callback);
+    head = NULL;
+}
+
+void sleep_timer_start(sleep_timer_t *timer, uint32_t delay_ms, int work_id, uint32_t arg) {
+    uint32_t save = spin_lock_blocking(lock);
+    if (timer->pending) {
+        unlink(timer);
+    }
+    timer->deadline_ms = sleep_timer_now_ms() + delay_ms;
+    timer->work_id = work_id;
+    timer->arg = arg;
+    timer->pending = true;
+
+    // after any timer with the same deadline, so equal deadlines fire in start order
+    sleep_timer_t **p = &head;
+    while (*p && (*p)->deadline_ms <= timer->deadline_ms) {
+        p = &(*p)->next;
+    }
+    timer->next = *p;
+    *p = timer;
+
+    if (head == timer) {
+        expire_and_arm();
+    }
+    spin_unlock(lock, save);
+}
+
+void sleep_timer_cancel(sleep_timer_t *timer) {
+    uint32_t save = spin_lock_blocking(lock);
+    if (timer->pending) {
+        bool was_head = head == timer;
+        unlink(timer);
+        if (was_head) {
+            expire_and_arm();
+        }
+    }
+    spin_unlock(lock, save);
+}
+
+bool sleep_timer_next_deadline(uint64_t *deadline_ms) {
+    uint32_t save = spin_lock_blocking(lock);
+    bool any = head != NULL;
+    if (any) {
+        *deadline_ms = head->deadline_ms;
+    }
+    spin_unlock(lock, save);
+    return any;
+}
+
+void sleep_timer_get_isr_timing(isr_timing_t *timing) {
+    *timing = isr_timing;
+}
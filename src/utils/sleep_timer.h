@@ -0,0 +1,41 @@
+#ifndef SLEEP_TIMER_H
+#define SLEEP_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "work_queue.h"
+
+// Wake-up deadlines on the monotonic microsecond timer instead of RTC
+// calendar alarms. Pending timers are kept sorted by deadline and one
+// hardware alarm is armed for the earliest; when it fires, every expired
+// timer hands its work id to the work queue, so the handlers run in thread
+// context. The timer keeps counting in light sleep (__wfi with clk_sys up).
+
+typedef struct sleep_timer {
+    uint64_t deadline_ms;       // on the sleep_timer_now_ms() timebase
+    int work_id;
+    uint32_t arg;
+    bool pending;
+    struct sleep_timer *next;
+} sleep_timer_t;
+
+// claims a hardware alarm, its interrupt runs on the calling core
+void sleep_timer_init(void);
+
+// milliseconds since boot
+uint64_t sleep_timer_now_ms(void);
+
+// (re)starts timer to defer work_id with arg after delay_ms; timer storage
+// belongs to the caller and must stay valid while it is pending
+void sleep_timer_start(sleep_timer_t *timer, uint32_t delay_ms, int work_id, uint32_t arg);
+
+// no effect on a timer that is not pending
+void sleep_timer_cancel(sleep_timer_t *timer);
+
+// earliest pending deadline, false if nothing is queued
+bool sleep_timer_next_deadline(uint64_t *deadline_ms);
+
+// execution time of the alarm interrupt
+void sleep_timer_get_isr_timing(isr_timing_t *timing);
+
+#endif //SLEEP_TIMER_H
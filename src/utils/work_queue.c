@@ -0,0 +1,64 @@
+#include "work_queue.h"
+#include "pico/stdlib.h"
+#include "circular_buffer.h"
+#include "event_loop.h"
+#include "config/config.h"
+
+typedef struct {
+    uint8_t id;
+    uint32_t arg;
+    uint32_t time_us;
+} work_item_t;
+
+static work_item_t ring_storage[WORK_QUEUE_DEPTH];
+static circular_buffer_t ring;
+
+static work_handler_t handlers[WORK_MAX_HANDLERS];
+static work_stats_t stats[WORK_MAX_HANDLERS];
+static int handler_count;
+
+void work_queue_init(void) {
+    circular_buffer_init(&ring, ring_storage, sizeof(work_item_t), WORK_QUEUE_DEPTH);
+}
+
+int work_register(work_handler_t handler, const char *name) {
+    if (handler_count == WORK_MAX_HANDLERS) {
+        return -1;
+    }
+    handlers[handler_count] = handler;
+    stats[handler_count] = (work_stats_t) { .name = name };
+    return handler_count++;
+}
+
+bool work_defer(int id, uint32_t arg) {
+    work_item_t item = { .id = (uint8_t) id, .arg = arg, .time_us = time_us_32() };
+    stats[id].deferred++;
+    if (!circular_buffer_push(&ring, &item)) {
+        stats[id].dropped++;
+        return false;
+    }
+    event_post(EVENT_WORK);
+    return true;
+}
+
+void work_run(void) {
+    work_item_t item;
+    while (circular_buffer_pop(&ring, &item)) {
+        work_stats_t *st = &stats[item.id];
+        uint32_t latency = time_us_32() - item.time_us;
+        st->runs++;
+        st->total_latency_us += latency;
+        if (latency > st->max_latency_us) {
+            st->max_latency_us = latency;
+        }
+        handlers[item.id](item.arg, latency);
+    }
+}
+
+bool work_get_stats(int id, work_stats_t *out) {
+    if (id < 0 || id >= handler_count) {
+        return false;
+    }
+    *out = stats[id];
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Deferred work for interrupt handlers. An ISR only records a work id, an
+// argument and a timestamp in a lock-free ring and posts EVENT_WORK; the
+// main loop runs the registered handler in thread context, where I2C,
+// printf and RTC calls are allowed. Producers are the core0 interrupt
+// handlers at the default priority, which do not preempt each other, so the
+// ring stays single-producer.
+
+#define WORK_MAX_HANDLERS   8
+
+// arg is what the ISR passed, latency_us the time from work_defer() to the call
+typedef void (*work_handler_t)(uint32_t arg, uint32_t latency_us);
+
+typedef struct {
+    const char *name;
+    uint32_t deferred;          // work_defer() calls
+    uint32_t dropped;           // lost because the ring was full
+    uint32_t runs;
+    uint32_t max_latency_us;    // interrupt to handler
+    uint32_t total_latency_us;
+} work_stats_t;
+
+// ISR execution time, kept by the code that owns the handler
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint32_t total_us;
+} isr_timing_t;
+
+void work_queue_init(void);
+
+// returns the id to pass to work_defer(), or -1 when the table is full
+int work_register(work_handler_t handler, const char *name);
+
+// interrupt context; returns false if the ring is full
+bool work_defer(int id, uint32_t arg);
+
+// thread context, runs everything queued so far
+void work_run(void);
+
+// false for an id that was never registered
+bool work_get_stats(int id, work_stats_t *stats);
+
+static inline void isr_timing_record(isr_timing_t *timing, uint32_t start_us, uint32_t end_us) {
+    uint32_t us = end_us - start_us;
+    timing->count++;
+    timing->total_us += us;
+    if (us > timing->max_us) {
+        timing->max_us = us;
+    }
+}
+
+#endif //WORK_QUEUE_H
@@ -0,0 +1,91 @@
+// Per-sample cost of the integer motion engine against the float/double
+// magnitude test it replaced (raw counts to g, sqrt(pow(...)) against 0.10 g).
+// Both must agree on which samples are moving.
+
+#include "motion.h"
+#include "bench.h"
+#include <math.h>
+#include <stdio.h>
+
+#define SAMPLES         4096
+#define THRESHOLD_MG    100
+
+// the replaced LIS3_raw_to_g + LIS3_is_moving pair
+#define OLD_SCALING (64 / 0.004f)
+#define OLD_THRESHOLD_G 0.10f
+
+static lis3_raw_t samples[SAMPLES];
+
+__attribute__((noinline))
+static bool old_is_moving(const lis3_raw_t *raw) {
+    lis3_data_t d;
+    d.x = (float) raw->x / OLD_SCALING;
+    d.y = (float) raw->y / OLD_SCALING;
+    d.z = (float) raw->z / OLD_SCALING;
+    double magnitude = sqrt(pow(d.x, 2) + pow(d.y, 2) + pow(d.z, 2));
+    return magnitude > OLD_THRESHOLD_G;
+}
+
+// high-pass filtered data: noise around zero with bursts of movement
+static void make_samples(void) {
+    uint32_t seed = 0x12345678u;
+    for (int i = 0; i < SAMPLES; i++) {
+        int amplitude = (i / 256) % 3 == 2 ? 8000 : 800;
+        samples[i].x = (int16_t) ((int32_t) (bench_rand(&seed) % (2 * amplitude)) - amplitude);
+        samples[i].y = (int16_t) ((int32_t) (bench_rand(&seed) % (2 * amplitude)) - amplitude);
+        samples[i].z = (int16_t) ((int32_t) (bench_rand(&seed) % (2 * amplitude)) - amplitude);
+    }
+}
+
+int main(void) {
+    make_samples();
+
+    motion_engine_t m;
+    motion_init(&m, THRESHOLD_MG, 50);
+    int moving = 0;
+    for (int i = 0; i < SAMPLES; i++) {
+        bool fast = motion_update(&m, &samples[i]);
+        if (fast != old_is_moving(&samples[i])) {
+            fprintf(stderr, "FAIL: sample %d (%d, %d, %d) integer %d, float %d\n", i,
+                    samples[i].x, samples[i].y, samples[i].z, fast, !fast);
+            return 1;
+        }
+        moving += fast;
+    }
+    if (moving == 0 || moving == SAMPLES) {
+        fprintf(stderr, "FAIL: test data does not exercise both sides of the threshold\n");
+        return 1;
+    }
+
+    uint64_t best_int = UINT64_MAX;
+    uint64_t best_batch = UINT64_MAX;
+    uint64_t best_old = UINT64_MAX;
+    volatile uint32_t sink = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        motion_init(&m, THRESHOLD_MG, 50);
+        uint64_t t0 = bench_now();
+        for (int i = 0; i < SAMPLES; i++) {
+            sink += motion_update(&m, &samples[i]);
+        }
+        uint64_t t1 = bench_now();
+        for (int i = 0; i < SAMPLES; i += LIS3_FIFO_DEPTH) {
+            sink += motion_update_batch(&m, &samples[i], LIS3_FIFO_DEPTH);
+        }
+        uint64_t t2 = bench_now();
+        for (int i = 0; i < SAMPLES; i++) {
+            sink += old_is_moving(&samples[i]);
+        }
+        uint64_t t3 = bench_now();
+
+        if (t1 - t0 < best_int) best_int = t1 - t0;
+        if (t2 - t1 < best_batch) best_batch = t2 - t1;
+        if (t3 - t2 < best_old) best_old = t3 - t2;
+    }
+
+    printf("motion: %d of %d samples moving, both paths agree\n", moving, SAMPLES);
+    printf("  integer engine, polled: %6.2f %s/sample\n", (double) best_int / SAMPLES, BENCH_UNIT);
+    printf("  integer engine, batch:  %6.2f %s/sample\n", (double) best_batch / SAMPLES, BENCH_UNIT);
+    printf("  float/double sqrt:      %6.2f %s/sample\n", (double) best_old / SAMPLES, BENCH_UNIT);
+    printf("  (host FPU; the RP2040 runs the float path in software)\n");
+    return 0;
+}
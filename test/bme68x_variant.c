@@ -0,0 +1,102 @@
+// Built once per BME68X_VARIANT (int or fpu), see bme68x_variant.h.
+
+#include "bme68x_variant.h"
+#include <string.h>
+
+#define VARIANT_CAT2(a, b) a##_##b
+#define VARIANT_CAT(a, b) VARIANT_CAT2(a, b)
+#define V(name) VARIANT_CAT(name, BME68X_VARIANT)
+
+#define bme68x_init V(bme68x_init)
+#define bme68x_init_with_calib V(bme68x_init_with_calib)
+#define bme68x_set_regs V(bme68x_set_regs)
+#define bme68x_get_regs V(bme68x_get_regs)
+#define bme68x_soft_reset V(bme68x_soft_reset)
+#define bme68x_set_conf V(bme68x_set_conf)
+#define bme68x_get_conf V(bme68x_get_conf)
+#define bme68x_set_op_mode V(bme68x_set_op_mode)
+#define bme68x_get_op_mode V(bme68x_get_op_mode)
+#define bme68x_get_meas_dur V(bme68x_get_meas_dur)
+#define bme68x_get_data V(bme68x_get_data)
+#define bme68x_get_forced_data_burst V(bme68x_get_forced_data_burst)
+#define bme68x_set_heatr_conf V(bme68x_set_heatr_conf)
+#define bme68x_get_heatr_conf V(bme68x_get_heatr_conf)
+#define bme68x_selftest_check V(bme68x_selftest_check)
+
+#include "bme68x.c"
+#include "bme680_fixed.h"
+
+static uint8_t regs[256];
+static struct bme68x_dev dev;
+
+static BME68X_INTF_RET_TYPE fake_read(uint8_t reg, uint8_t *data, uint32_t len, void *intf_ptr) {
+    (void) intf_ptr;
+    for (uint32_t i = 0; i < len; i++) {
+        data[i] = regs[(uint8_t) (reg + i)];
+    }
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static BME68X_INTF_RET_TYPE fake_write(uint8_t reg, const uint8_t *data, uint32_t len, void *intf_ptr) {
+    (void) intf_ptr;
+    // the driver sends (register, value) pairs after the first register
+    regs[reg] = data[0];
+    for (uint32_t i = 1; i + 1 < len; i += 2) {
+        regs[data[i]] = data[i + 1];
+    }
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static void fake_delay(uint32_t period, void *intf_ptr) {
+    (void) period;
+    (void) intf_ptr;
+}
+
+static void load_device(const uint8_t *calib, uint8_t variant_id) {
+    memset(regs, 0, sizeof(regs));
+    memcpy(&regs[BME68X_REG_COEFF1], calib, BME68X_LEN_COEFF1);
+    memcpy(&regs[BME68X_REG_COEFF2], calib + BME68X_LEN_COEFF1, BME68X_LEN_COEFF2);
+    memcpy(&regs[BME68X_REG_COEFF3], calib + BME68X_LEN_COEFF1 + BME68X_LEN_COEFF2, BME68X_LEN_COEFF3);
+    regs[BME68X_REG_CHIP_ID] = BME68X_CHIP_ID;
+    regs[BME68X_REG_VARIANT_ID] = variant_id;
+
+    memset(&dev, 0, sizeof(dev));
+    dev.intf = BME68X_I2C_INTF;
+    dev.read = fake_read;
+    dev.write = fake_write;
+    dev.delay_us = fake_delay;
+    dev.amb_temp = 25;
+}
+
+static bool variant_init(const uint8_t *calib, uint8_t variant_id) {
+    load_device(calib, variant_id);
+    return bme68x_init(&dev) == BME68X_OK;
+}
+
+static int8_t variant_reinit(const uint8_t *calib, uint8_t variant_id) {
+    struct bme68x_calib_data stored = dev.calib;
+    uint8_t stored_variant = dev.variant_id;
+    load_device(calib, variant_id);
+    dev.calib = stored;
+    dev.variant_id = stored_variant;
+    return bme68x_init_with_calib(&dev);
+}
+
+static bool variant_read(const uint8_t *field, bme68x_fixed_t *out) {
+    memcpy(&regs[BME68X_REG_FIELD0], field, BME68X_LEN_FIELD);
+
+    struct bme68x_data data;
+    uint8_t n_fields;
+    if (bme68x_get_data(BME68X_FORCED_MODE, &data, &n_fields, &dev) != BME68X_OK) {
+        return false;
+    }
+    bme680_field_to_fixed(&data, &out->temperature, &out->humidity, &out->pressure, &out->gas_resistance);
+    return true;
+}
+
+const bme68x_variant_t V(bme68x_variant) = {
+    .name = VARIANT_NAME,
+    .init = variant_init,
+    .reinit = variant_reinit,
+    .read = variant_read,
+};
@@ -0,0 +1,34 @@
+// One build of the vendor BME68x driver behind a fake register map. The
+// driver is compiled twice, integer (BME68X_DO_NOT_USE_FPU) and FPU, with its
+// API renamed per build so both can live in one test binary.
+#ifndef BME68X_VARIANT_H
+#define BME68X_VARIANT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BME68X_VARIANT_CALIB_LEN    42  // COEFF1, COEFF2, COEFF3 in get_calib_data order
+#define BME68X_VARIANT_FIELD_LEN    17
+
+typedef struct {
+    int16_t temperature;        // degrees C x100
+    uint32_t humidity;          // % relative humidity x1000
+    uint32_t pressure;          // Pa
+    uint32_t gas_resistance;    // ohms
+} bme68x_fixed_t;
+
+typedef struct {
+    const char *name;
+    // loads the calibration through bme68x_init, false if the driver refused it
+    bool (*init)(const uint8_t *calib, uint8_t variant_id);
+    // bme68x_init_with_calib against a sensor with this calibration, the
+    // stored copy being the one the previous init loaded; returns the driver result
+    int8_t (*reinit)(const uint8_t *calib, uint8_t variant_id);
+    // compensates one raw field through bme68x_get_data and bme680_field_to_fixed
+    bool (*read)(const uint8_t *field, bme68x_fixed_t *out);
+} bme68x_variant_t;
+
+extern const bme68x_variant_t bme68x_variant_int;
+extern const bme68x_variant_t bme68x_variant_fpu;
+
+#endif //BME68X_VARIANT_H
@@ -0,0 +1,14 @@
+// Host stand-in for the Pico SDK header: output pins are not modelled.
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+static inline void gpio_put(uint gpio, bool value) {
+    (void) gpio;
+    (void) value;
+}
+
+#endif //HOST_HARDWARE_GPIO_H
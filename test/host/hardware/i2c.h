@@ -0,0 +1,10 @@
+// Host stand-in for the Pico SDK header: the modules under test only pass
+// i2c_inst_t pointers around and never reach the bus.
+#ifndef HOST_HARDWARE_I2C_H
+#define HOST_HARDWARE_I2C_H
+
+#include "pico/stdlib.h"    // the SDK header pulls in the time types
+
+typedef struct i2c_inst i2c_inst_t;
+
+#endif //HOST_HARDWARE_I2C_H
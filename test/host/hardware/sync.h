@@ -0,0 +1,32 @@
+// Host stand-in for the Pico SDK header: the tests run on one thread, so
+// the hardware spin locks have nothing to exclude.
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+typedef volatile uint32_t spin_lock_t;
+
+static inline int spin_lock_claim_unused(bool required) {
+    (void) required;
+    return 0;
+}
+
+static inline spin_lock_t *spin_lock_instance(uint lock_num) {
+    static spin_lock_t locks[32];
+    return &locks[lock_num];
+}
+
+static inline uint32_t spin_lock_blocking(spin_lock_t *lock) {
+    (void) lock;
+    return 0;
+}
+
+static inline void spin_unlock(spin_lock_t *lock, uint32_t saved_irq) {
+    (void) lock;
+    (void) saved_irq;
+}
+
+#endif //HOST_HARDWARE_SYNC_H
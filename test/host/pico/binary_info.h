@@ -0,0 +1,5 @@
+// Host stand-in for the Pico SDK header: there is no binary to annotate.
+#ifndef HOST_PICO_BINARY_INFO_H
+#define HOST_PICO_BINARY_INFO_H
+
+#endif //HOST_PICO_BINARY_INFO_H
@@ -0,0 +1,26 @@
+// Host stand-in for the Pico SDK header: time only moves when the test
+// advances host_time_us.
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+extern uint64_t host_time_us;
+
+static inline uint64_t time_us_64(void) {
+    return host_time_us;
+}
+
+static inline absolute_time_t get_absolute_time(void) {
+    return host_time_us;
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t) (t / 1000);
+}
+
+#endif //HOST_PICO_STDLIB_H
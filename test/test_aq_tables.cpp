@@ -0,0 +1,158 @@
+// The compile-time AQI and VOC tables against the runtime functions they
+// replaced: the EPA equation evaluated per reading in float, and the VOC
+// power law squared per reading. The tables must stay within 1 AQI point of
+// the exact equation over every input the PMSA003 can report; the timing
+// compares one lookup with one call of each replaced function.
+
+#include "aq_tables.h"
+#include "aq_tables.hpp"
+#include "config/config.h"
+
+extern "C" {
+#include "bench.h"
+}
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#define AQI_TOLERANCE       1
+#define VOC_TOLERANCE_PPB   4       //the grid interpolates a parabola, h^2 / 8 * f''
+#define VOC_TOLERANCE_PERMILLE 10   //the grid step that holds the saturation knee cuts its corner
+#define BENCH_INPUTS        4096
+
+struct float_breakpoint {
+    float c_lo, c_hi;
+    float i_lo, i_hi;
+};
+
+// the EPA table as the firmware would have carried it at runtime, ug/m3
+static const float_breakpoint pm25_float[] = {
+    {0.0f, 9.0f, 0, 50}, {9.1f, 35.4f, 51, 100}, {35.5f, 55.4f, 101, 150},
+    {55.5f, 125.4f, 151, 200}, {125.5f, 225.4f, 201, 300}, {225.5f, 325.4f, 301, 500},
+};
+
+static const float_breakpoint pm10_float[] = {
+    {0, 54, 0, 50}, {55, 154, 51, 100}, {155, 254, 101, 150},
+    {255, 354, 151, 200}, {355, 424, 201, 300}, {425, 604, 301, 500},
+};
+
+// concentration truncated to the EPA reporting precision, then the linear equation
+__attribute__((noinline))
+static uint16_t old_aqi(const float_breakpoint *bp, int n, float c, float precision) {
+    c = std::floor(c / precision) * precision;
+    for (int i = 0; i < n; i++) {
+        if (c <= bp[i].c_hi + precision / 2) {
+            float aqi = (bp[i].i_hi - bp[i].i_lo) / (bp[i].c_hi - bp[i].c_lo) * (c - bp[i].c_lo) + bp[i].i_lo;
+            return (uint16_t) std::lround(aqi);
+        }
+    }
+    return 500;
+}
+
+// iaq.c before the table: the power law squared on every reading
+__attribute__((noinline))
+static uint32_t old_voc_ppb(uint32_t ratio_q8) {
+    uint64_t voc = ((uint64_t) IAQ_VOC_CLEAN_PPB * ratio_q8 * ratio_q8) >> 16;
+    return voc > IAQ_VOC_MAX_PPB ? IAQ_VOC_MAX_PPB : (uint32_t) voc;
+}
+
+// bme680.c before the IAQ estimator: piecewise float curve on gas resistance in kohms
+__attribute__((noinline))
+static float old_voc_ppm(float resistance_k) {
+    if (resistance_k >= 50.0f) {
+        return 0.0f;
+    } else if (resistance_k >= 10.0f) {
+        return (50.0f - resistance_k) * (1.0f / 40.0f);
+    } else if (resistance_k >= 5.0f) {
+        return 1.0f + (10.0f - resistance_k) * (5.0f / 5.0f);
+    } else if (resistance_k >= 2.0f) {
+        return 6.0f + (5.0f - resistance_k) * (4.0f / 3.0f);
+    }
+    return 10.0f + (2.0f - resistance_k) * (40.0f / 2.0f);
+}
+
+static int failures;
+
+static void check(const char *what, uint32_t x, long table, long exact, long tol) {
+    if (std::labs(table - exact) > tol) {
+        if (failures < 20) {
+            std::fprintf(stderr, "FAIL: %s at %u: table %ld, exact %ld\n", what, x, table, exact);
+        }
+        failures++;
+    }
+}
+
+static int worst(uint32_t end, uint32_t step, uint32_t (*table)(uint32_t), long (*exact)(uint32_t)) {
+    long w = 0;
+    for (uint32_t x = 0; x <= end; x += step) {
+        long d = std::labs((long) table(x) - exact(x));
+        if (d > w) w = d;
+    }
+    return (int) w;
+}
+
+static uint32_t table_pm25(uint32_t x10) { return aq_pm25_aqi(x10); }
+static uint32_t table_pm10(uint32_t x10) { return aq_pm10_aqi(x10); }
+static long exact_pm25(uint32_t x10) { return old_aqi(pm25_float, 6, x10 / 10.0f, 0.1f); }
+static long exact_pm10(uint32_t x10) { return old_aqi(pm10_float, 6, x10 / 10.0f, 1.0f); }
+
+int main() {
+    // PM2.5 at 0.1 ug/m3, PM10 in whole ug/m3 as the EPA truncates it, past saturation
+    for (uint32_t x = 0; x <= 4000; x++) {
+        check("PM2.5 AQI", x, aq_pm25_aqi(x), exact_pm25(x), AQI_TOLERANCE);
+    }
+    for (uint32_t x = 0; x <= 7000; x += 10) {
+        check("PM10 AQI", x, aq_pm10_aqi(x), exact_pm10(x), AQI_TOLERANCE);
+    }
+    for (uint32_t r = 0; r <= IAQ_RATIO_MAX_Q8; r++) {
+        long exact = old_voc_ppb(r);
+        long tol = exact * VOC_TOLERANCE_PERMILLE / 1000;
+        check("VOC", r, aq_voc_ppb(r), exact, tol > VOC_TOLERANCE_PPB ? tol : VOC_TOLERANCE_PPB);
+    }
+    // the anomaly trigger stays at the pre-table 12 ug/m3 PM2.5 limit
+    if (aq_pm_aqi(12, 0) > AQI_ABNORMAL_THRESHOLD || aq_pm_aqi(13, 0) <= AQI_ABNORMAL_THRESHOLD) {
+        std::fprintf(stderr, "FAIL: AQI_ABNORMAL_THRESHOLD %d: 12 ug/m3 gives %u, 13 ug/m3 gives %u\n",
+                     AQI_ABNORMAL_THRESHOLD, aq_pm_aqi(12, 0), aq_pm_aqi(13, 0));
+        failures++;
+    }
+    std::printf("aq tables: %d mismatches, worst PM2.5 %d, PM10 %d AQI points\n", failures,
+                worst(4000, 1, table_pm25, exact_pm25), worst(7000, 10, table_pm10, exact_pm10));
+
+    static uint32_t pm[BENCH_INPUTS], ratio[BENCH_INPUTS];
+    static float gas_k[BENCH_INPUTS];
+    uint32_t seed = 0xa91u;
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        pm[i] = bench_rand(&seed) % 1500;  // 0 to 150 ug/m3 x10, indoor and smoke
+        ratio[i] = bench_rand(&seed) % (IAQ_RATIO_MAX_Q8 + 1);
+        gas_k[i] = (float) (bench_rand(&seed) % 60000) / 1000.0f;
+    }
+
+    uint64_t best[5] = {UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX};
+    volatile uint32_t sink = 0;
+    volatile float fsink = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        uint64_t t[6];
+        t[0] = bench_now();
+        for (int i = 0; i < BENCH_INPUTS; i++) sink += aq_pm25_aqi(pm[i]);
+        t[1] = bench_now();
+        for (int i = 0; i < BENCH_INPUTS; i++) sink += old_aqi(pm25_float, 6, pm[i] / 10.0f, 0.1f);
+        t[2] = bench_now();
+        for (int i = 0; i < BENCH_INPUTS; i++) sink += aq_voc_ppb(ratio[i]);
+        t[3] = bench_now();
+        for (int i = 0; i < BENCH_INPUTS; i++) sink += old_voc_ppb(ratio[i]);
+        t[4] = bench_now();
+        for (int i = 0; i < BENCH_INPUTS; i++) fsink = fsink + old_voc_ppm(gas_k[i]);
+        t[5] = bench_now();
+        for (int k = 0; k < 5; k++) {
+            if (t[k + 1] - t[k] < best[k]) best[k] = t[k + 1] - t[k];
+        }
+    }
+    const char *names[5] = {"PM2.5 AQI table", "PM2.5 AQI float equation", "VOC table",
+                            "VOC power law", "VOC float curve (original)"};
+    for (int k = 0; k < 5; k++) {
+        std::printf("  %-27s %6.1f %s/lookup\n", names[k], (double) best[k] / BENCH_INPUTS, BENCH_UNIT);
+    }
+    std::printf("  (the host has an FPU and a divider, the RP2040 has neither)\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,239 @@
+// Golden vectors for the BME68x compensation: the integer build used on the
+// RP2040 against the FPU build, both through bme680_field_to_fixed(), plus a
+// per-sample timing of each. The FPU build is the reference; a handful of
+// pinned outputs catch changes to both at once.
+
+#include "bme68x_variant.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// integer against float, in the fixed-point units of bme68x_fixed_t
+#define TOL_TEMPERATURE     2       //0.02 degrees C
+#define TOL_HUMIDITY        100     //0.1 %RH
+#define TOL_PRESSURE        6       //Pa, the integer path rounds each of its divisions
+#define TOL_GAS_PERMILLE    10      //1%
+#define TOL_GAS_STEP        100     //ohms, the integer BME688 formula scales by 100 last
+
+#define VARIANT_GAS_LOW     0x00    //BME680
+#define VARIANT_GAS_HIGH    0x01    //BME688
+
+#define CALIB_OK            0       //BME68X_OK
+#define CALIB_RELOADED      4       //BME68X_W_CALIB_RELOADED
+
+#define BENCH_FIELDS        4096
+
+static uint8_t calib[BME68X_VARIANT_CALIB_LEN];
+
+static void put16(int idx_lsb, int idx_msb, int32_t v) {
+    calib[idx_lsb] = (uint8_t) (v & 0xFF);
+    calib[idx_msb] = (uint8_t) ((v >> 8) & 0xFF);
+}
+
+// coefficients in the range of production BME680 parts, laid out at the
+// driver's BME68X_IDX_* positions
+static void make_calib(void) {
+    memset(calib, 0, sizeof(calib));
+    put16(0, 1, 26305);     // par_t2
+    calib[2] = 3;           // par_t3
+    put16(4, 5, 36101);     // par_p1
+    put16(6, 7, -10443);    // par_p2
+    calib[8] = 88;          // par_p3
+    put16(10, 11, 6950);    // par_p4
+    put16(12, 13, -44);     // par_p5
+    calib[14] = 41;         // par_p7
+    calib[15] = 30;         // par_p6
+    put16(18, 19, -1798);   // par_p8
+    put16(20, 21, -3683);   // par_p9
+    calib[22] = 30;         // par_p10
+    // par_h2 = 1003 and par_h1 = 796 share the nibbles of byte 24
+    calib[23] = 1003 >> 4;
+    calib[24] = (uint8_t) (((1003 & 0x0F) << 4) | (796 & 0x0F));
+    calib[25] = 796 >> 4;
+    calib[26] = 0;          // par_h3
+    calib[27] = 45;         // par_h4
+    calib[28] = 20;         // par_h5
+    calib[29] = 120;        // par_h6
+    calib[30] = (uint8_t) -100;  // par_h7
+    put16(31, 32, 26145);   // par_t1
+    put16(33, 34, -5969);   // par_gh2
+    calib[35] = (uint8_t) -30;   // par_gh1
+    calib[36] = 18;         // par_gh3
+    calib[37] = 50;         // res_heat_val
+    calib[39] = 0x10;       // res_heat_range 1
+    calib[41] = 0x00;       // range_sw_err
+}
+
+// one forced-mode field as the sensor lays it out from 0x1D
+static void make_field(uint8_t *f, uint32_t adc_t, uint32_t adc_p, uint16_t adc_h,
+                       uint16_t adc_g, uint8_t range) {
+    memset(f, 0, BME68X_VARIANT_FIELD_LEN);
+    f[0] = 0x80;                                // new data, gas index 0
+    f[2] = (uint8_t) (adc_p >> 12);
+    f[3] = (uint8_t) (adc_p >> 4);
+    f[4] = (uint8_t) ((adc_p & 0x0F) << 4);
+    f[5] = (uint8_t) (adc_t >> 12);
+    f[6] = (uint8_t) (adc_t >> 4);
+    f[7] = (uint8_t) ((adc_t & 0x0F) << 4);
+    f[8] = (uint8_t) (adc_h >> 8);
+    f[9] = (uint8_t) adc_h;
+    // the same gas reading in the low (BME680) and high (BME688) slots, valid and stable
+    f[13] = f[15] = (uint8_t) (adc_g >> 2);
+    f[14] = f[16] = (uint8_t) (((adc_g & 0x03) << 6) | 0x30 | (range & 0x0F));
+}
+
+static int failures;
+
+static void check(const char *what, int64_t a, int64_t b, int64_t tol, const char *ctx) {
+    if (llabs(a - b) > tol) {
+        fprintf(stderr, "FAIL: %s %s: integer %lld, float %lld\n", ctx, what, (long long) a, (long long) b);
+        failures++;
+    }
+}
+
+static void compare(const uint8_t *field, const char *ctx) {
+    bme68x_fixed_t i, f;
+    if (!bme68x_variant_int.read(field, &i) || !bme68x_variant_fpu.read(field, &f)) {
+        fprintf(stderr, "FAIL: %s: driver returned an error\n", ctx);
+        failures++;
+        return;
+    }
+    check("temperature", i.temperature, f.temperature, TOL_TEMPERATURE, ctx);
+    check("humidity", i.humidity, f.humidity, TOL_HUMIDITY, ctx);
+    check("pressure", i.pressure, f.pressure, TOL_PRESSURE, ctx);
+    int64_t tol_gas = (int64_t) f.gas_resistance * TOL_GAS_PERMILLE / 1000 + 1;
+    check("gas", i.gas_resistance, f.gas_resistance, tol_gas > TOL_GAS_STEP ? tol_gas : TOL_GAS_STEP, ctx);
+}
+
+typedef struct {
+    uint32_t adc_t, adc_p;
+    uint16_t adc_h, adc_g;
+    uint8_t range;
+    bme68x_fixed_t expected;    // FPU build, BME680 gas variant
+} golden_t;
+
+static const golden_t golden[] = {
+#include "data/bme68x_golden.inc"
+};
+
+static int run_grid(uint8_t variant_id) {
+    if (!bme68x_variant_int.init(calib, variant_id) || !bme68x_variant_fpu.init(calib, variant_id)) {
+        fprintf(stderr, "FAIL: bme68x_init refused the calibration\n");
+        return 1;
+    }
+    uint8_t field[BME68X_VARIANT_FIELD_LEN];
+    char ctx[96];
+    int n = 0;
+    // about -12 to 63 degrees C and 51 to 103 kPa; the integer cubic pressure term
+    // wraps int32 above ~106 kPa with par_p10 = 30
+    for (uint32_t adc_t = 380000; adc_t <= 620000; adc_t += 20000) {
+        for (uint32_t adc_p = 375000; adc_p <= 625000; adc_p += 50000) {
+            for (uint16_t adc_h = 12000; adc_h <= 36000; adc_h += 4000) {
+                for (uint8_t range = 0; range < 16; range += 3) {
+                    uint16_t adc_g = (uint16_t) (100 + (adc_t / 1000 + range * 57) % 900);
+                    make_field(field, adc_t, adc_p, adc_h, adc_g, range);
+                    snprintf(ctx, sizeof(ctx), "variant %u T %u P %u H %u G %u/%u",
+                             variant_id, adc_t, adc_p, adc_h, adc_g, range);
+                    compare(field, ctx);
+                    n++;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+// a calibration restored from flash has to be caught on a different sensor
+static void check_stored_calib(void) {
+    static const struct {
+        const char *what;
+        int idx;                // calibration byte changed on the attached sensor, -1 for none
+        uint8_t variant_id;
+        int8_t expected;
+    } cases[] = {
+        {"same sensor", -1, VARIANT_GAS_LOW, CALIB_OK},
+        {"par_h6 differs", 29, VARIANT_GAS_LOW, CALIB_RELOADED},
+        {"par_t1 differs", 31, VARIANT_GAS_LOW, CALIB_RELOADED},
+        {"par_gh2 differs", 33, VARIANT_GAS_LOW, CALIB_RELOADED},
+        {"res_heat_val differs", 37, VARIANT_GAS_LOW, CALIB_RELOADED},
+        {"variant differs", -1, VARIANT_GAS_HIGH, CALIB_RELOADED},
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint8_t other[BME68X_VARIANT_CALIB_LEN];
+        memcpy(other, calib, sizeof(other));
+        if (cases[c].idx >= 0) {
+            other[cases[c].idx] ^= 0x5A;
+        }
+        bme68x_variant_int.init(calib, VARIANT_GAS_LOW);
+        int8_t rslt = bme68x_variant_int.reinit(other, cases[c].variant_id);
+        // after a reload the stored copy matches the sensor again
+        int8_t again = bme68x_variant_int.reinit(other, cases[c].variant_id);
+        if (rslt != cases[c].expected || again != CALIB_OK) {
+            fprintf(stderr, "FAIL: stored calibration, %s: %d then %d, expected %d then 0\n",
+                    cases[c].what, rslt, again, cases[c].expected);
+            failures++;
+        }
+    }
+}
+
+static uint64_t bench(const bme68x_variant_t *v, const uint8_t *fields) {
+    uint64_t best = UINT64_MAX;
+    bme68x_fixed_t out;
+    volatile uint32_t sink = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        uint64_t t0 = bench_now();
+        for (int i = 0; i < BENCH_FIELDS; i++) {
+            v->read(&fields[i * BME68X_VARIANT_FIELD_LEN], &out);
+            sink += out.gas_resistance;
+        }
+        uint64_t t = bench_now() - t0;
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+int main(void) {
+    make_calib();
+
+    int n = run_grid(VARIANT_GAS_LOW);
+    n += run_grid(VARIANT_GAS_HIGH);
+    check_stored_calib();
+
+    // pinned outputs, BME680 variant
+    bme68x_variant_int.init(calib, VARIANT_GAS_LOW);
+    bme68x_variant_fpu.init(calib, VARIANT_GAS_LOW);
+    for (size_t g = 0; g < sizeof(golden) / sizeof(golden[0]); g++) {
+        const golden_t *v = &golden[g];
+        uint8_t field[BME68X_VARIANT_FIELD_LEN];
+        make_field(field, v->adc_t, v->adc_p, v->adc_h, v->adc_g, v->range);
+        bme68x_fixed_t f;
+        bme68x_variant_fpu.read(field, &f);
+        if (f.temperature != v->expected.temperature || f.humidity != v->expected.humidity
+                || f.pressure != v->expected.pressure || f.gas_resistance != v->expected.gas_resistance) {
+            fprintf(stderr, "FAIL: golden vector %zu: %d %u %u %u\n", g,
+                    f.temperature, f.humidity, f.pressure, f.gas_resistance);
+            failures++;
+        }
+        char ctx[32];
+        snprintf(ctx, sizeof(ctx), "golden vector %zu", g);
+        compare(field, ctx);
+    }
+
+    printf("bme68x compensation: %d grid fields and %zu golden vectors, %d mismatches\n",
+           n, sizeof(golden) / sizeof(golden[0]), failures);
+
+    static uint8_t fields[BENCH_FIELDS * BME68X_VARIANT_FIELD_LEN];
+    uint32_t seed = 0xb0e680u;
+    for (int i = 0; i < BENCH_FIELDS; i++) {
+        make_field(&fields[i * BME68X_VARIANT_FIELD_LEN], 380000 + bench_rand(&seed) % 240000,
+                   375000 + bench_rand(&seed) % 250000, (uint16_t) (12000 + bench_rand(&seed) % 24000),
+                   (uint16_t) (100 + bench_rand(&seed) % 900), (uint8_t) (bench_rand(&seed) % 16));
+    }
+    uint64_t t_int = bench(&bme68x_variant_int, fields);
+    uint64_t t_fpu = bench(&bme68x_variant_fpu, fields);
+    printf("  integer build: %7.1f %s/sample\n", (double) t_int / BENCH_FIELDS, BENCH_UNIT);
+    printf("  FPU build:     %7.1f %s/sample\n", (double) t_fpu / BENCH_FIELDS, BENCH_UNIT);
+    printf("  (both include the same fake register reads; the host has an FPU, the RP2040 does not)\n");
+    return failures ? 1 : 0;
+}
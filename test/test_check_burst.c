@@ -0,0 +1,96 @@
+// The timer-wake check path from the PMSA003 side: the sleep pre-wake turns
+// the fan on SLEEP_PM_WARMUP_MS before the burst, the burst reads a frame
+// whenever the sensor has a fresh one and every sample votes through the
+// anomaly detector. A burst of high PM must confirm even though the frame
+// detector cannot settle in that time; a fan that has only just started must not vote.
+
+#include "anomaly.h"
+#include "pm_scheduler.h"
+#include "config/config.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+
+uint64_t host_time_us;
+
+// pm_scheduler only reads frames inside its own windows, which stay suspended here
+pmsa003_status_t pmsa003_read_frame(pmsa003_data_t *data) {
+    (void) data;
+    return PMSA003_DUPLICATE;
+}
+
+static const pm_window_config_t window_config = {
+    .spinup_ms = PM_WINDOW_SPINUP_MS,
+    .stabilise_ms = PM_WINDOW_STABILISE_MS,
+    .frames = PM_WINDOW_FRAMES,
+    .period_ms = PM_WINDOW_PERIOD_MS,
+    .check_on_ms = PM_CHECK_FAN_ON_MS
+};
+
+static int failures;
+
+static void advance_ms(uint32_t ms) {
+    host_time_us += (uint64_t) ms * 1000;
+}
+
+// one burst as core1 runs it, fan_on_ms after the pre-wake; pm_settled
+// reports whether the frame detector itself was ready at the end
+static anomaly_verdict_t run_burst(uint16_t pm2_5, uint32_t fan_on_ms, bool *pm_settled) {
+    pm_scheduler_suspend();
+    advance_ms(SLEEP_PRE_WAKE_MS);
+    pm_scheduler_power(true);
+    advance_ms(fan_on_ms);
+
+    anomaly_detector_t det;
+    anomaly_init(&det, ANOMALY_VOTES, ANOMALY_WINDOW);
+    anomaly_verdict_t verdict = ANOMALY_PENDING;
+    uint64_t last_frame_us = 0;
+    for (int i = 0; i < ANOMALY_WINDOW && verdict == ANOMALY_PENDING; i++) {
+        acq_sample_t sample;
+        memset(&sample, 0, sizeof(sample));
+        // VOC stays out of the vote, the baseline is still burning in
+        sample.flags = ACQ_FLAG_CHECK | ACQ_FLAG_AIR;
+        sample.air.iaq_accuracy = IAQ_ACCURACY_UNRELIABLE;
+        if (last_frame_us == 0 || host_time_us - last_frame_us >= PMSA003_UPDATE_PERIOD_MS * 1000) {
+            last_frame_us = host_time_us;
+            sample.flags |= ACQ_FLAG_PM;
+            sample.pm.pm2_5_env = pm2_5;
+            sample.pm.pm10_env = pm2_5;
+            pm_scheduler_observe(&sample.pm);
+            if (!pm_scheduler_check_ready()) {
+                sample.flags |= ACQ_FLAG_PM_WARMING;
+            }
+        }
+        if (i == ANOMALY_WINDOW - 1) {
+            sample.flags |= ACQ_FLAG_CHECK_DONE;
+        }
+        verdict = anomaly_update(&det, &sample);
+        advance_ms(ACQ_CHECK_PERIOD_MS);
+    }
+    *pm_settled = pm_scheduler_ready();
+    return verdict == ANOMALY_PENDING ? ANOMALY_NORMAL : verdict;
+}
+
+static void expect(const char *what, anomaly_verdict_t got, anomaly_verdict_t want) {
+    if (got != want) {
+        fprintf(stderr, "FAIL: %s: verdict %d, expected %d\n", what, got, want);
+        failures++;
+    }
+}
+
+int main(void) {
+    host_time_us = 1000000;
+    pm_scheduler_init(&window_config);
+
+    bool settled;
+    expect("smoke after the pre-wake", run_burst(60, SLEEP_PM_WARMUP_MS, &settled), ANOMALY_CONFIRMED);
+    if (settled) {
+        fprintf(stderr, "FAIL: the frame detector settled within one burst, the check path is not exercised\n");
+        failures++;
+    }
+    expect("clean air after the pre-wake", run_burst(4, SLEEP_PM_WARMUP_MS, &settled), ANOMALY_NORMAL);
+    expect("smoke with the fan just started", run_burst(60, PM_WINDOW_SPINUP_MS / 2, &settled), ANOMALY_NORMAL);
+
+    printf("check burst: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+// Producer/consumer stress test of the SPSC ring on two host threads, the
+// same split as core1 pushing samples and core0 popping them.
+
+#include "circular_buffer.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ITEMS       2000000u
+#define CAPACITY    16u
+
+// larger than a word so a torn copy shows up as a checksum mismatch
+typedef struct {
+    uint32_t seq;
+    uint32_t payload[5];
+    uint32_t check;
+} item_t;
+
+static item_t storage[CAPACITY];
+static circular_buffer_t ring;
+static volatile uint32_t full_spins;
+
+static uint32_t checksum(const item_t *item) {
+    uint32_t c = item->seq * 2654435761u;
+    for (int i = 0; i < 5; i++) {
+        c ^= item->payload[i] + (c << 6) + (c >> 2);
+    }
+    return c;
+}
+
+static void *producer(void *arg) {
+    (void) arg;
+    for (uint32_t seq = 0; seq < ITEMS; seq++) {
+        item_t item = { .seq = seq };
+        for (int i = 0; i < 5; i++) {
+            item.payload[i] = seq * (i + 3) + 0x9e3779b9u;
+        }
+        item.check = checksum(&item);
+        while (!circular_buffer_push(&ring, &item)) {
+            full_spins++;
+            sched_yield(); // the consumer may share this CPU
+        }
+    }
+    return NULL;
+}
+
+int main(void) {
+    circular_buffer_init(&ring, storage, sizeof(item_t), CAPACITY);
+
+    item_t item;
+    if (circular_buffer_pop(&ring, &item) || circular_buffer_count(&ring) != 0) {
+        fprintf(stderr, "FAIL: new ring not empty\n");
+        return 1;
+    }
+    // every slot is usable, the next push is refused
+    for (uint32_t i = 0; i < CAPACITY; i++) {
+        item.seq = i;
+        if (!circular_buffer_push(&ring, &item)) {
+            fprintf(stderr, "FAIL: push %u of %u refused\n", i, CAPACITY);
+            return 1;
+        }
+    }
+    if (circular_buffer_push(&ring, &item) || circular_buffer_count(&ring) != CAPACITY) {
+        fprintf(stderr, "FAIL: full ring accepted a push\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < CAPACITY; i++) {
+        if (!circular_buffer_pop(&ring, &item) || item.seq != i) {
+            fprintf(stderr, "FAIL: pop %u out of order\n", i);
+            return 1;
+        }
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, producer, NULL) != 0) {
+        fprintf(stderr, "FAIL: pthread_create\n");
+        return 1;
+    }
+
+    uint32_t expected = 0;
+    uint32_t empty_spins = 0;
+    while (expected < ITEMS) {
+        if (!circular_buffer_pop(&ring, &item)) {
+            empty_spins++;
+            sched_yield();
+            continue;
+        }
+        if (item.seq != expected || item.check != checksum(&item)) {
+            fprintf(stderr, "FAIL: item %u: got seq %u, check %s\n", expected, item.seq,
+                    item.check == checksum(&item) ? "ok" : "torn");
+            return 1;
+        }
+        expected++;
+    }
+    pthread_join(thread, NULL);
+
+    if (circular_buffer_pop(&ring, &item)) {
+        fprintf(stderr, "FAIL: ring not empty after the run\n");
+        return 1;
+    }
+    printf("circular_buffer: %u items through %u slots, %u full and %u empty retries\n",
+           ITEMS, CAPACITY, full_spins, empty_spins);
+    return 0;
+}
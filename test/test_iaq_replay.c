@@ -0,0 +1,149 @@
+// Replays BME680 traces through iaq_update(). Each line is
+// time_ms,gas_ohms,humidity_x1000[,label]; '#' starts a comment. With
+// BME680_TRACE_OUTPUT set the firmware logs the same lines after "trace:".
+//
+// Every trace is checked for a valid index range and the burn-in accuracy.
+// Labelled traces also get behavioural checks per segment:
+//   clean    VOC near the clean-air value, accuracy at least LOW at its end
+//   voc      VOC well above the first clean segment, index higher
+//   recover  no checks of its own
+//   humid    humidity alone must not read as VOC
+// A clean segment after an event fails if the baseline learned the event.
+
+#include "iaq.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LABELS 8
+
+typedef struct {
+    char name[16];
+    uint32_t samples;
+    uint64_t voc_sum;
+    uint64_t index_sum;
+    uint32_t voc_max;
+    iaq_accuracy_t last_accuracy;
+} segment_t;
+
+static int failures;
+
+static void fail(const char *trace, const char *what) {
+    fprintf(stderr, "FAIL: %s: %s\n", trace, what);
+    failures++;
+}
+
+// consecutive lines with the same label form one segment
+static segment_t segments[64];
+static int n_segments;
+
+static int replay(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    iaq_estimator_t iaq;
+    iaq_init(&iaq);
+    n_segments = 0;
+
+    char line[128];
+    uint32_t n = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        unsigned long t, gas, hum;
+        char label[16] = "";
+        if (sscanf(line, "%lu,%lu,%lu,%15[^,\r\n]", &t, &gas, &hum, label) < 3) {
+            fprintf(stderr, "%s: bad line: %s", path, line);
+            fclose(f);
+            return -1;
+        }
+
+        iaq_result_t r;
+        iaq_update(&iaq, (uint32_t) gas, (uint32_t) hum, &r);
+        n++;
+
+        if (r.index > 500) {
+            fail(path, "index above 500");
+        }
+        if (n <= IAQ_BURN_IN_SAMPLES && r.accuracy != IAQ_ACCURACY_UNRELIABLE) {
+            fail(path, "accuracy set during burn-in");
+        }
+
+        if (label[0] == '\0') {
+            continue;
+        }
+        if (n_segments == 0 || strcmp(segments[n_segments - 1].name, label) != 0) {
+            if (n_segments == (int) (sizeof(segments) / sizeof(segments[0]))) {
+                fail(path, "too many segments");
+                break;
+            }
+            memset(&segments[n_segments], 0, sizeof(segment_t));
+            strcpy(segments[n_segments].name, label);
+            n_segments++;
+        }
+        segment_t *s = &segments[n_segments - 1];
+        s->samples++;
+        s->voc_sum += r.voc_ppb;
+        s->index_sum += r.index;
+        if (r.voc_ppb > s->voc_max) {
+            s->voc_max = r.voc_ppb;
+        }
+        s->last_accuracy = r.accuracy;
+    }
+    fclose(f);
+
+    printf("%s: %u samples, final accuracy %d\n", path, n, iaq.accuracy);
+    const segment_t *clean = NULL;
+    for (int i = 0; i < n_segments; i++) {
+        const segment_t *s = &segments[i];
+        uint32_t voc = (uint32_t) (s->voc_sum / s->samples);
+        uint32_t index = (uint32_t) (s->index_sum / s->samples);
+        printf("  %-8s %4u samples  mean VOC %6u ppb (max %6u)  mean index %3u\n",
+               s->name, s->samples, voc, s->voc_max, index);
+
+        if (strcmp(s->name, "clean") == 0) {
+            if (s->last_accuracy < IAQ_ACCURACY_LOW) {
+                fail(path, "accuracy still unreliable after a clean segment");
+            }
+            if (voc > 2 * IAQ_VOC_CLEAN_PPB) {
+                fail(path, "clean air reads as VOC");
+            }
+            if (!clean) {
+                clean = s;
+            }
+        } else if (!clean) {
+            continue;
+        } else if (strcmp(s->name, "voc") == 0) {
+            uint32_t clean_voc = (uint32_t) (clean->voc_sum / clean->samples);
+            uint32_t clean_index = (uint32_t) (clean->index_sum / clean->samples);
+            if (s->voc_max < 4 * clean_voc) {
+                fail(path, "VOC event not detected");
+            }
+            if (index <= clean_index + 50) {
+                fail(path, "VOC event does not raise the index");
+            }
+        } else if (strcmp(s->name, "humid") == 0) {
+            if (voc > 2 * (uint32_t) (clean->voc_sum / clean->samples)) {
+                fail(path, "humidity reads as VOC");
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s trace.csv...\n", argv[0]);
+        return 2;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (replay(argv[i]) < 0) {
+            return 2;
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+// The LIS3DH driver against a fake register map on a counting I2C stub.
+// LIS3_read_raw() has to fetch all three axes as one repeated-start transfer
+// (sub-address write, 6-byte auto-increment read) where the per-axis reads
+// through LIS3_read_axis() took six, and decode the same values.
+
+#include "lis3.h"
+#include <stdio.h>
+
+#define AUTO_INCREMENT_BIT  0x80
+
+uint64_t host_time_us;
+
+static uint8_t regs[256];
+static int transfers;       // i2c_dma_transfer_blocking calls
+static int bus_phases;      // write and read phases, a register read is both
+static uint8_t last_sub;
+
+void i2c_dma_device_init(i2c_dma_device_t *dev, i2c_inst_t *i2c, uint8_t addr,
+                         i2c_dma_priority_t priority, uint32_t timeout_us, const char *name) {
+    (void) dev;
+    (void) i2c;
+    (void) addr;
+    (void) priority;
+    (void) timeout_us;
+    (void) name;
+}
+
+// the LIS3DH only advances the register address when the sub-address MSB is set;
+// returns the bytes read, or written for a write-only transfer, as i2c_dma does
+int i2c_dma_transfer_blocking(i2c_dma_device_t *dev, const uint8_t *src, size_t wlen,
+                              uint8_t *dst, size_t rlen) {
+    (void) dev;
+    transfers++;
+    bus_phases += (wlen > 0) + (rlen > 0);
+    last_sub = src[0];
+    uint8_t reg = src[0] & ~AUTO_INCREMENT_BIT;
+    uint8_t step = (src[0] & AUTO_INCREMENT_BIT) ? 1 : 0;
+    for (size_t i = 1; i < wlen; i++) {
+        regs[(uint8_t) (reg + (i - 1) * step)] = src[i];
+    }
+    for (size_t i = 0; i < rlen; i++) {
+        dst[i] = regs[(uint8_t) (reg + i * step)];
+    }
+    return (int) (rlen ? rlen : wlen);
+}
+
+static int failures;
+
+static void expect(const char *what, long got, long want) {
+    if (got != want) {
+        fprintf(stderr, "FAIL: %s: %ld, expected %ld\n", what, got, want);
+        failures++;
+    }
+}
+
+int main(void) {
+    LIS3_init(NULL, 2);
+
+    // -1 g, +0.5 g and +1 g left-justified at 4 mg per 64 LSB
+    const int16_t x = -16000, y = 8000, z = 16000;
+    regs[OUT_X_L] = (uint8_t) x;
+    regs[OUT_X_H] = (uint8_t) ((uint16_t) x >> 8);
+    regs[OUT_Y_L] = (uint8_t) y;
+    regs[OUT_Y_H] = (uint8_t) ((uint16_t) y >> 8);
+    regs[OUT_Z_L] = (uint8_t) z;
+    regs[OUT_Z_H] = (uint8_t) ((uint16_t) z >> 8);
+
+    LIS3_reset_bus_transactions();
+    expect("transactions after reset", LIS3_get_bus_transactions(), 0);
+
+    transfers = bus_phases = 0;
+    lis3_raw_t raw = {0, 0, 0};
+    expect("LIS3_read_raw result", LIS3_read_raw(&raw), true);
+    expect("LIS3_read_raw transfers", transfers, 1);
+    int raw_phases = bus_phases;
+    expect("LIS3_read_raw bus phases", raw_phases, 2);
+    expect("LIS3_read_raw reg_cache transactions", LIS3_get_bus_transactions(), 1);
+    expect("LIS3_read_raw sub-address", last_sub, OUT_X_L | AUTO_INCREMENT_BIT);
+    expect("x", raw.x, x);
+    expect("y", raw.y, y);
+    expect("z", raw.z, z);
+
+    // the per-axis reads LIS3_read_raw replaced
+    LIS3_reset_bus_transactions();
+    transfers = bus_phases = 0;
+    lis3_data_t axes = {
+        LIS3_read_axis(OUT_X_L, OUT_X_H), LIS3_read_axis(OUT_Y_L, OUT_Y_H), LIS3_read_axis(OUT_Z_L, OUT_Z_H)
+    };
+    expect("LIS3_read_axis x3 bus phases", bus_phases, 12);
+    expect("LIS3_read_axis x3 reg_cache transactions", LIS3_get_bus_transactions(), 6);
+    lis3_data_t g = LIS3_raw_to_g(&raw);
+    expect("x in mg", (long) (g.x * 1000), (long) (axes.x * 1000));
+    expect("y in mg", (long) (g.y * 1000), (long) (axes.y * 1000));
+    expect("z in mg", (long) (g.z * 1000), (long) (axes.z * 1000));
+
+    printf("lis3: one sample in %d bus phases, %d through per-axis reads, %d failures\n",
+           raw_phases, bus_phases, failures);
+    return failures ? 1 : 0;
+}